@@ -0,0 +1,115 @@
+"""Renders the PnC monitor's binary telemetry as a live table of every SysVar.
+
+With MONITOR_BINARY_TELEMETRY set in pnc-fsw/include/SysHead.h the monitor
+writes one PnC record holding every SysVar per cycle over USB serial, in the
+data log format read by parse_pnc.py, with the schema header every
+MONITOR_SCHEMA_INTERVAL records. Text log lines between frames are skipped.
+
+usage: python monitor_telemetry.py /dev/ttyACM0 [--csv telemetry.csv]
+       python monitor_telemetry.py capture.bin --csv telemetry.csv --quiet
+"""
+import argparse
+import os
+import struct
+import sys
+import tty
+
+import parse_pnc
+
+# frames are far smaller, anything longer is a false sync
+MAX_FRAME = 4096
+# the length field sits at the same offset in the header and records
+length_struct = struct.Struct("<H")
+LENGTH_OFFSET = 6
+
+
+def read_frames(buf: bytearray, state: dict):
+  """Yields (uptime, {group name: fields dict}) for every complete record at
+  the start of buf, removing the bytes used. Records before the first schema
+  header are dropped."""
+  while True:
+    starts = [p for p in (buf.find(parse_pnc.HEADER_SYNC),
+                          buf.find(parse_pnc.RECORD_SYNC)) if p >= 0]
+    if not starts:
+      # keep what could be the start of a split sync
+      del buf[:max(0, len(buf) - 3)]
+      return
+    del buf[:min(starts)]
+    if len(buf) < LENGTH_OFFSET + length_struct.size:
+      return
+    (length,) = length_struct.unpack_from(buf, LENGTH_OFFSET)
+    if length > MAX_FRAME:
+      del buf[:1]
+      continue
+    if len(buf) < length:
+      return
+
+    frame = bytes(buf[:length])
+    if frame.startswith(parse_pnc.HEADER_SYNC):
+      schema = parse_pnc.read_schema(frame)
+      if schema is None:
+        del buf[:1]
+        continue
+      state["schema"] = schema[0]
+    elif "schema" in state:
+      records = list(parse_pnc.read_records(frame, state["schema"], 0))
+      if not records:
+        del buf[:1]
+        continue
+      yield records[0]
+    del buf[:length]
+
+
+def render(uptime: int, latest: dict, columns: list) -> None:
+  lines = [f"uptime {uptime / 1000:.1f} s"]
+  lines += [f"{c:<22}{latest.get(c, '')}" for c in columns]
+  # home the cursor and clear, so the table redraws in place
+  sys.stdout.write("\x1b[H\x1b[J" + "\n".join(lines) + "\n")
+  sys.stdout.flush()
+
+
+def main() -> None:
+  parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+  parser.add_argument("source", help="serial device or capture file")
+  parser.add_argument("--csv", help="also append every record to this CSV")
+  parser.add_argument("--quiet", action="store_true",
+                      help="don't draw the table")
+  args = parser.parse_args()
+
+  columns = [f for fields, _ in parse_pnc.GROUPS.values() for f in fields]
+  fd = os.open(args.source, os.O_RDONLY)
+  if os.isatty(fd):
+    # binary frames must not go through line editing
+    tty.setraw(fd)
+  fout = None
+  if args.csv:
+    fout = open(args.csv, "w")
+    fout.write("uptime," + ",".join(columns) + "\n")
+
+  buf = bytearray()
+  state = {}
+  latest = {}
+  count = 0
+  try:
+    while chunk := os.read(fd, 4096):
+      buf += chunk
+      for uptime, groups in read_frames(buf, state):
+        for fields in groups.values():
+          latest.update(fields)
+        if fout:
+          fout.write(f"{uptime}," +
+                     ",".join(str(latest.get(c, "")) for c in columns) + "\n")
+        if not args.quiet:
+          render(uptime, latest, columns)
+        count += 1
+  except KeyboardInterrupt:
+    pass
+  finally:
+    os.close(fd)
+    if fout:
+      fout.close()
+  print(f"{count} records")
+
+
+if __name__ == "__main__":
+  main()
@@ -1,21 +1,177 @@
-import struct 
-
-num = 60
-packet_fmt = "<IIBBfIfIfIfffIB?BB8ib"
-packet_struct = struct.Struct(packet_fmt)
-total_packets = []
-
-while True:
-    try:
-        filename = f"data{num}.bin"
-        with open(filename, "rb") as file:
-            packet = file.read(packet_struct.size)
-            while len(packet) == packet_struct.size:
-                data = packet_struct.unpack(packet)
-                print(",".join([str(d) for d in data]))
-                total_packets.append(data)
-                packet = file.read(packet_struct.size)
-    except FileNotFoundError:
-        print("error")
-        break 
-    num+=1
\ No newline at end of file
+"""Decodes the PnC data log (data<n>.bin) into a CSV.
+
+Files start with a schema header listing every SysVar group's id, size and
+name, see pnc-fsw/include/PnCLog.h. Each record then holds only the groups
+written since the previous one, so groups missing from a record carry their
+last value forward. Groups the schema names but this script doesn't know are
+skipped by their size, groups whose layout has since changed are read with
+their earlier layout from OLD_GROUPS.
+
+Files from firmware before the schema header are fixed 0xDEADCAFE packets
+holding every group, and are decoded into the same columns.
+
+usage: python parse_pnc.py data0.bin [data1.bin ...]
+"""
+import struct
+import sys
+
+HEADER_SYNC = b"PNCH"
+RECORD_SYNC = b"PNCR"
+VERSION = 1
+
+# sync, version, group_count, length
+header_struct = struct.Struct("<4sBBH")
+# id, size, name
+group_struct = struct.Struct("<BH13s")
+# sync, version, reserved, length, uptime, present
+record_struct = struct.Struct("<4sBBHII")
+
+# SysVar group name -> (field names, struct format), in SysVar.h order
+GROUPS = {
+    "pico_temp_c": (["pico_temp_c"], "<f"),
+    "rtc_time": (["rtc_time"], "<I"),
+    "ina_data": (["ina_current", "ina_bus_voltage", "ina_power"], "<fff"),
+    "bme_data": (["bme_temp", "bme_pressure", "bme_humidity",
+                  "bme_gas_resistance"], "<fIfI"),
+    "gps_data": (["gps_unix_time_s", "gps_fix_type", "gps_fix_ok", "gps_siv",
+                  "gps_lat_e7", "gps_lon_e7", "gps_alt_msl_mm",
+                  "gps_vel_n_mmps",
+                  "gps_vel_e_mmps", "gps_vel_d_mmps", "gps_hacc_mm",
+                  "gps_vacc_mm", "gps_itow_ms"], "<IB?Bx8iI"),
+    "rc_realtime": (["rc_count_rate_cps", "rc_dose_rate_uR_h", "rc_dose_uR",
+                     "rc_temperature_c", "rc_acc_x", "rc_acc_y", "rc_acc_z"],
+                    "<IIIfhhh"),
+}
+
+# (group name, size) -> (field names, struct format) of earlier layouts
+OLD_GROUPS = {
+    ("gps_data", 40): (GROUPS["gps_data"][0][:-1], "<IB?Bx8i"),
+    ("rc_realtime", 24): (GROUPS["rc_realtime"][0], "<IIIfhhh2x"),
+}
+
+# sync, uptime, id, length, pico_temp_c, rtc_time, bme_data, ina_data,
+# gps_data, checksum
+LEGACY_SYNC = b"\xfe\xca\xad\xde"
+legacy_struct = struct.Struct("<IIBBfIfIfIfffIB?Bx8ib")
+LEGACY_GROUPS = [("pico_temp_c", 4), ("rtc_time", 4), ("bme_data", 16),
+                 ("ina_data", 12), ("gps_data", 40)]
+
+
+def checksum_valid(record: bytes) -> bool:
+  # sum complement of every byte, the checksum byte is signed
+  return (sum(record[:-1]) + struct.unpack("<b", record[-1:])[0]) % 256 == 0
+
+
+def group_layout(name: str, size: int):
+  """Returns (field names, struct format) for a group as stored, or None"""
+  if name in GROUPS and struct.calcsize(GROUPS[name][1]) == size:
+    return GROUPS[name]
+  return OLD_GROUPS.get((name, size))
+
+
+def read_schema(data: bytes):
+  """Returns ({bit: (name, size)}, header length) or None if data doesn't
+  start with a valid schema header"""
+  if len(data) < header_struct.size or not data.startswith(HEADER_SYNC):
+    return None
+  _, version, group_count, length = header_struct.unpack_from(data, 0)
+  header = data[:length]
+  if (version != VERSION or
+      length != header_struct.size + group_count * group_struct.size + 1 or
+      len(header) != length or not checksum_valid(header)):
+    return None
+
+  schema = {}
+  for i in range(group_count):
+    gid, size, name = group_struct.unpack_from(
+        data, header_struct.size + i * group_struct.size)
+    schema[gid] = (name.rstrip(b"\0").decode(), size)
+  return schema, length
+
+
+def read_records(data: bytes, schema: dict, pos: int):
+  """Yields (uptime, {group name: fields dict}) for every valid record"""
+  while (pos := data.find(RECORD_SYNC, pos)) >= 0:
+    if pos + record_struct.size > len(data):
+      break
+    _, version, _, length, uptime, present = record_struct.unpack_from(
+        data, pos)
+    record = data[pos:pos + length]
+    if (version != VERSION or length < record_struct.size + 1 or
+        len(record) != length or not checksum_valid(record)):
+      print(f"Bad record at {pos}", file=sys.stderr)
+      pos += 1
+      continue
+
+    groups = {}
+    p = record_struct.size
+    for gid in sorted(schema):
+      if not present & (1 << gid):
+        continue
+      name, size = schema[gid]
+      layout = group_layout(name, size)
+      if layout is not None:
+        fields, fmt = layout
+        groups[name] = dict(zip(fields, struct.unpack_from(fmt, record, p)))
+      p += size
+    if p + 1 != length:
+      print(f"Record at {pos} doesn't match the schema", file=sys.stderr)
+    else:
+      yield uptime, groups
+    pos += length
+
+
+def read_legacy(data: bytes):
+  """Yields (uptime, {group name: fields dict}) for every fixed packet. The
+  old checksum also summed its own uninitialised byte, so it isn't checked"""
+  pos = 0
+  while (pos := data.find(LEGACY_SYNC, pos)) >= 0:
+    if pos + legacy_struct.size > len(data):
+      break
+    values = legacy_struct.unpack_from(data, pos)
+    if values[3] != legacy_struct.size:
+      pos += 1
+      continue
+    uptime = values[1]
+    values = values[4:-1]
+    groups = {}
+    for name, size in LEGACY_GROUPS:
+      fields, _ = group_layout(name, size)
+      n = len(fields)
+      groups[name] = dict(zip(fields, values[:n]))
+      values = values[n:]
+    yield uptime, groups
+    pos += legacy_struct.size
+
+
+def read_pnc(filename: str):
+  """Yields (uptime, {group name: fields dict}) for either file format"""
+  with open(filename, "rb") as f:
+    data = f.read()
+
+  schema = read_schema(data)
+  if schema is None:
+    yield from read_legacy(data)
+  else:
+    yield from read_records(data, schema[0], schema[1])
+
+
+def convert_pnc(filename: str) -> None:
+  print("Converting " + filename)
+  columns = [f for fields, _ in GROUPS.values() for f in fields]
+  latest = {}
+  count = 0
+  with open(filename[:-4] + ".csv", "w") as fout:
+    fout.write("uptime,updated," + ",".join(columns) + "\n")
+    for uptime, groups in read_pnc(filename):
+      for fields in groups.values():
+        latest.update(fields)
+      fout.write(f"{uptime}," + "|".join(groups) + "," +
+                 ",".join(str(latest.get(c, "")) for c in columns) + "\n")
+      count += 1
+  print(f"{count} records")
+
+
+if __name__ == "__main__":
+  for filename in sys.argv[1:]:
+    convert_pnc(filename)
@@ -0,0 +1,79 @@
+"""Decodes the PnC RadiaCode event log (rc<n>.bin) into a CSV per event type.
+
+Every record is a tag byte (0xA0 | type), the length of the event fields, the
+PnC millis when the DATA_BUF was read, the packed event struct from
+pnc-fsw/lib/RadiaCodeBLELib/src/Events.h and an int8 sum complement checksum.
+
+usage: python parse_rc.py rc0.bin [rc1.bin ...]
+"""
+import struct
+import sys
+
+RECORD_MARK = 0xA0
+header_struct = struct.Struct("<BBI")
+
+# DataPointType -> (name, field names, struct format), in Events.h field order
+EVENT_TYPES = {
+    0: ("Real", ["dt", "count_rate", "dose_rate", "count_rate_err",
+                 "dose_rate_err", "flags", "rt_flags"], "<IffHHHB"),
+    1: ("Raw", ["dt", "count_rate", "dose_rate"], "<Iff"),
+    2: ("Dose", ["dt", "count", "count_rate", "dose_rate", "dose_rate_err",
+                 "flags"], "<IIffHH"),
+    3: ("Rare", ["dt", "duration", "dose", "temperature", "charge_level",
+                 "flags"], "<IIfHHH"),
+    4: ("Eve", ["dt", "event", "event_param1", "flags"], "<IBBH"),
+    5: ("RawDose", ["dt", "dose_rate", "flags"], "<IfH"),
+    6: ("RawCount", ["dt", "count_rate", "flags"], "<IfH"),
+    8: ("None", ["eid", "gid"], "<BB"),
+}
+
+
+def checksum_valid(record: bytes) -> bool:
+  # sum complement of every byte, the checksum byte is signed
+  return (sum(record[:-1]) + struct.unpack("<b", record[-1:])[0]) % 256 == 0
+
+
+def read_events(filename: str):
+  """Yields (type name, millis, fields dict) for every valid record"""
+  with open(filename, "rb") as f:
+    data = f.read()
+
+  pos = 0
+  while pos + header_struct.size < len(data):
+    tag, length, millis = header_struct.unpack_from(data, pos)
+    etype = tag & 0x0F
+    record_len = header_struct.size + length + 1
+    record = data[pos:pos + record_len]
+    if ((tag & 0xF0) != RECORD_MARK or etype not in EVENT_TYPES or
+        struct.calcsize(EVENT_TYPES[etype][2]) != length or
+        len(record) != record_len or not checksum_valid(record)):
+      # resync on the next byte
+      pos += 1
+      continue
+
+    name, fields, fmt = EVENT_TYPES[etype]
+    values = struct.unpack_from(fmt, data, pos + header_struct.size)
+    yield name, millis, dict(zip(fields, values))
+    pos += record_len
+
+
+def convert_rc(filename: str) -> None:
+  print("Converting " + filename)
+  outputs = {}
+  counts = {}
+  for name, millis, fields in read_events(filename):
+    if name not in outputs:
+      outputs[name] = open(f"{filename[:-4]}_{name}.csv", "w")
+      outputs[name].write("millis," + ",".join(fields) + "\n")
+      counts[name] = 0
+    outputs[name].write(f"{millis}," +
+                        ",".join(str(v) for v in fields.values()) + "\n")
+    counts[name] += 1
+  for out in outputs.values():
+    out.close()
+  print(", ".join(f"{counts[n]} {n}" for n in counts))
+
+
+if __name__ == "__main__":
+  for filename in sys.argv[1:]:
+    convert_rc(filename)
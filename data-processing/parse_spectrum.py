@@ -0,0 +1,126 @@
+"""Decodes the PnC RadiaCode spectrum log (spec<n>.bin) into a CSV.
+
+Each record is a keyframe (counts relative to zero) or a delta against the
+previous record, see pnc-fsw/include/SpectrumLog.h. Deltas after a corrupt
+record are skipped until the next keyframe. Version 2 records only carry the
+energy calibration in keyframes, version 1 records in every header.
+
+usage: python parse_spectrum.py spec0.bin [spec1.bin ...]
+"""
+import struct
+import sys
+
+SYNC = b"SPEC"
+KEYFRAME = 0
+DELTA = 1
+
+# sync, version, type, length
+prefix_struct = struct.Struct("<4sBBH")
+# uptime, device_ts, a0, a1, a2, channels
+v1_header_struct = struct.Struct("<IIfffH")
+# uptime, device_ts, channels, then a0, a1, a2 in keyframes
+v2_header_struct = struct.Struct("<IIH")
+calibration_struct = struct.Struct("<fff")
+
+
+def read_varint(data: bytes, pos: int) -> tuple[int, int]:
+  value = 0
+  shift = 0
+  while True:
+    byte = data[pos]
+    pos += 1
+    value |= (byte & 0x7F) << shift
+    if byte < 0x80:
+      return value, pos
+    shift += 7
+
+
+def unzigzag(value: int) -> int:
+  return (value >> 1) ^ -(value & 1)
+
+
+def checksum_valid(record: bytes) -> bool:
+  # sum complement of every byte, the checksum byte is signed
+  return (sum(record[:-1]) + struct.unpack("<b", record[-1:])[0]) % 256 == 0
+
+
+def read_spectra(filename: str):
+  """Yields (uptime, device_ts, a0, a1, a2, counts) for every decodable
+  record"""
+  with open(filename, "rb") as f:
+    data = f.read()
+
+  previous = None
+  calibration = None
+  pos = 0
+  while (pos := data.find(SYNC, pos)) >= 0:
+    if pos + prefix_struct.size > len(data):
+      break
+    _, version, rtype, length = prefix_struct.unpack_from(data, pos)
+    record = data[pos:pos + length]
+    if version == 1:
+      header_size = prefix_struct.size + v1_header_struct.size
+    else:
+      header_size = prefix_struct.size + v2_header_struct.size
+      if rtype == KEYFRAME:
+        header_size += calibration_struct.size
+    if (version not in (1, 2) or length < header_size + 1 or
+        len(record) != length or not checksum_valid(record)):
+      print(f"Bad record at {pos}, waiting for a keyframe", file=sys.stderr)
+      previous = None
+      pos += 1
+      continue
+
+    if version == 1:
+      (uptime, device_ts, a0, a1, a2,
+       channels) = v1_header_struct.unpack_from(data, pos + prefix_struct.size)
+      calibration = (a0, a1, a2)
+    else:
+      uptime, device_ts, channels = v2_header_struct.unpack_from(
+          data, pos + prefix_struct.size)
+      if rtype == KEYFRAME:
+        calibration = calibration_struct.unpack_from(
+            data, pos + prefix_struct.size + v2_header_struct.size)
+
+    if rtype == KEYFRAME or previous is None or len(previous) != channels:
+      if rtype != KEYFRAME:
+        # nothing to apply the delta to
+        pos += length
+        continue
+      counts = [0] * channels
+    else:
+      counts = list(previous)
+
+    at = 0
+    p = pos + header_size
+    while at < channels:
+      zero_run, p = read_varint(data, p)
+      literal_count, p = read_varint(data, p)
+      at += zero_run
+      for _ in range(literal_count):
+        delta, p = read_varint(data, p)
+        counts[at] += unzigzag(delta)
+        at += 1
+
+    previous = counts
+    yield (uptime, device_ts, *calibration, counts)
+    pos += length
+
+
+def convert_spectrum(filename: str) -> None:
+  print("Converting " + filename)
+  with open(filename[:-4] + ".csv", "w") as fout:
+    count = 0
+    for uptime, device_ts, a0, a1, a2, counts in read_spectra(filename):
+      if count == 0:
+        fout.write("uptime,device_ts,a0,a1,a2," +
+                   ",".join(f"ch{i}" for i in range(len(counts))) + "\n")
+      fout.write(f"{uptime},{device_ts},{a0},{a1},{a2}," +
+                 ",".join(str(c) for c in counts) + "\n")
+      count += 1
+  print(f"{count} spectra")
+
+
+if __name__ == "__main__":
+  for filename in sys.argv[1:]:
+    convert_spectrum(filename)
@@ -0,0 +1,69 @@
+/**
+ * @file Bench.h
+ * @brief Minimal on-target micro-benchmark harness
+ *
+ * Every benchmark is run for a fixed number of iterations, BENCH_SAMPLES
+ * times, after one warm-up sample. The median and minimum ns/op are reported
+ * as CSV lines so that runs can be diffed against each other.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <Arduino.h>
+
+/** @brief Number of timed samples per benchmark */
+#define BENCH_SAMPLES 7
+
+/**
+ * @brief Keeps the compiler from optimizing away a benchmarked result
+ *
+ * @param value Value to consume
+ */
+template <typename T>
+static inline void benchSink(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Prints the header of the benchmark report
+ *
+ * @param suite Name of the benchmark suite
+ */
+static inline void benchHeader(const char* suite) {
+  Serial.printf("# %s, %d samples, clock %lu Hz\n", suite, BENCH_SAMPLES,
+                (unsigned long)F_CPU);
+  Serial.printf("bench,iters,ns_per_op_median,ns_per_op_min\n");
+}
+
+/**
+ * @brief Times fn over iters iterations and prints one report line
+ *
+ * @param name Name of the benchmark
+ * @param iters Iterations per sample
+ * @param fn Operation to time, called once per iteration
+ * @return uint32_t Median ns/op
+ */
+template <typename F>
+uint32_t runBench(const char* name, uint32_t iters, F&& fn) {
+  uint32_t samples[BENCH_SAMPLES];
+
+  // warm up caches and branch predictors
+  for (uint32_t i = 0; i < iters; i++) fn();
+
+  for (int s = 0; s < BENCH_SAMPLES; s++) {
+    uint64_t start = time_us_64();
+    for (uint32_t i = 0; i < iters; i++) fn();
+    uint64_t elapsed_us = time_us_64() - start;
+    samples[s] = (uint32_t)((elapsed_us * 1000) / iters);
+  }
+
+  std::sort(samples, samples + BENCH_SAMPLES);
+  Serial.printf("%s,%lu,%lu,%lu\n", name, (unsigned long)iters,
+                (unsigned long)samples[BENCH_SAMPLES / 2],
+                (unsigned long)samples[0]);
+
+  return samples[BENCH_SAMPLES / 2];
+}
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ * @file bench_main.cpp
+ * @brief Micro-benchmarks for the packet hot paths, built with the bench env
+ *
+ * Flash with `pio run -e bench -t upload` and read the report over Serial.
+ * Stub sensors stand in for the hardware so only the packet code is timed.
+ */
+#include <Arduino.h>
+
+#include "Bench.h"
+#include "CsvWriter.h"
+#include "Packet.h"
+#include "PayloadConfig.h"
+#include "Sensor.h"
+
+/**
+ * @brief Sensor that writes a fixed ramp of floats instead of reading hardware
+ *
+ */
+class StubSensor : public Sensor {
+ private:
+  int floats;
+  float value;
+
+ public:
+  StubSensor(String name, String csv_header, int floats)
+      : Sensor(name, csv_header, 0UL) {
+    this->floats = floats;
+    this->value = 0;
+  }
+
+  bool verify() override { return true; }
+
+  String readData() override { return this->readEmpty(); }
+
+  void readDataPacket(uint8_t*& packet) override {
+    for (int i = 0; i < this->floats; i++) {
+      this->value += 0.25f;
+      memcpy(packet, &this->value, sizeof(float));
+      packet += sizeof(float);
+    }
+  }
+
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override {
+    for (int i = 0; i < this->floats; i++) {
+      float temp;
+      memcpy(&temp, packet, sizeof(float));
+      packet += sizeof(float);
+      csv.addFloat(temp);
+    }
+  }
+
+  /**
+   * @brief The String concatenation decode the sensors used before CsvWriter,
+   * kept as the baseline for the decode benchmarks
+   */
+  String legacyDecodeToCSV(uint8_t*& packet) {
+    String csv_row;
+    for (int i = 0; i < this->floats; i++) {
+      float temp;
+      memcpy(&temp, packet, sizeof(float));
+      packet += sizeof(float);
+      csv_row += String(temp) + ",";
+    }
+    return csv_row;
+  }
+};
+
+// clang-format off
+// field counts match the flight sensors
+StubSensor temp_stub    ("PicoTemp", "PicoTemp(C),",                  1);
+StubSensor icm_stub     ("ICM20948", "AccX,AccY,AccZ,GyroX,GyroY,GyroZ,MagX,MagY,MagZ,TempC,", 10);
+StubSensor tmp_stub     ("TMP117",   "TMP117Temp(C),",                1);
+StubSensor bme_stub     ("BME688",   "TempC,PresPa,Humidity,GasOhm,", 4);
+StubSensor geiger_stub  ("Geiger",   "CPS,Dose,",                     2);
+StubSensor uv_stub      ("AS7331",   "UVA,UVB,UVC,",                  3);
+StubSensor bmp_stub     ("BMP390",   "TempC,PresPa,Altm,",            3);
+StubSensor shtc3_stub   ("SHTC3",    "Temp(C),Humidity(%),",          2);
+// clang-format on
+
+Sensor* sensors[] = {&temp_stub,   &icm_stub, &tmp_stub, &bme_stub,
+                     &geiger_stub, &uv_stub,  &bmp_stub, &shtc3_stub};
+const int sensors_len = sizeof(sensors) / sizeof(sensors[0]);
+
+uint8_t packet[QT_ENTRY_SIZE];
+char csv_row[CSV_ROW_MAX_SIZE];
+
+/**
+ * @brief decodePacket as it was before CsvWriter, one String per cell
+ *
+ */
+String legacyDecodePacket(uint8_t* packet) {
+  uint32_t sensor_id;
+  memcpy(&sensor_id, packet + PACKET_SENSOR_ID_OFFSET, sizeof(sensor_id));
+  uint8_t* temp_packet = packet + PACKET_HEADER_SIZE;
+
+  String csv_row = String(sensor_id, HEX) + ",";
+  csv_row += String(packetMillis(packet)) + ",";
+
+  int id_offset = 0;
+  for (int i = 0; i < 32; i++) {
+    if (sensor_id & (1 << i)) id_offset = i;
+  }
+  for (int curr_offset = id_offset - 1;
+       curr_offset >= 0 && id_offset - curr_offset - 1 < sensors_len;
+       curr_offset--) {
+    StubSensor* stub = (StubSensor*)sensors[id_offset - curr_offset - 1];
+    if (sensor_id & (1 << curr_offset)) {
+      csv_row += stub->legacyDecodeToCSV(temp_packet);
+    } else {
+      csv_row += stub->readEmpty();
+    }
+  }
+  benchSink(packetChecksumValid(packet, packetLength(packet)));
+  return csv_row;
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) delay(10);
+  delay(1000);
+
+  for (int i = 0; i < sensors_len; i++) sensors[i]->attemptConnection();
+
+  benchHeader("payload-fsw packet");
+
+  runBench("readSensorDataPacket", 2000, [] {
+    benchSink(readSensorDataPacket(sensors, sensors_len, packet));
+  });
+
+  uint16_t packet_len = readSensorDataPacket(sensors, sensors_len, packet);
+
+  // rows/sec = 1e9 / ns_per_op
+  runBench("decodePacket_string_legacy", 500, [] {
+    String row = legacyDecodePacket(packet);
+    benchSink(row.length());
+  });
+
+  runBench("decodePacket", 500, [] {
+    String row = decodePacket(sensors, sensors_len, packet);
+    benchSink(row.length());
+  });
+
+  runBench("decodePacket_csvwriter", 500, [] {
+    CsvWriter csv(csv_row, sizeof(csv_row));
+    benchSink(decodePacket(sensors, sensors_len, packet, csv));
+  });
+
+  runBench("packetChecksum", 5000, [packet_len] {
+    benchSink(packetChecksum(packet, packet_len));
+  });
+
+  runBench("packetChecksum_max_len", 2000, [] {
+    benchSink(packetChecksum(packet, QT_ENTRY_SIZE));
+  });
+
+  runBench("packetChecksumValid", 5000, [packet_len] {
+    benchSink(packetChecksumValid(packet, packet_len));
+  });
+
+  Serial.printf("# done\n");
+}
+
+void loop() { delay(1000); }
@@ -23,7 +23,7 @@ class AS7331Sensor : public Sensor {
 
   bool verify() override;
   void readDataPacket(uint8_t*& packet) override;
-  String decodeToCSV(uint8_t*& packet) override;
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
   String readData() override;
 };
 
@@ -23,7 +23,7 @@ class BME688Sensor : public Sensor {
   bool verify() override;
   String readData() override;
   void readDataPacket(uint8_t*& packet) override;
-  String decodeToCSV(uint8_t*& packet) override;
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
 };
 
 #endif  // BME688_SENSOR_H
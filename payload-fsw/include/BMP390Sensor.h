@@ -28,7 +28,7 @@ class BMP390Sensor : public Sensor {
   bool verify() override;
   String readData() override;
   void readDataPacket(uint8_t*& packet) override;
-  String decodeToCSV(uint8_t*& packet) override;
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
 };
 
 #endif  // BMP384_SENSOR_H
\ No newline at end of file
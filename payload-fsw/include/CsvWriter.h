@@ -0,0 +1,60 @@
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+/**
+ * @brief Builds a CSV row directly into a caller-provided fixed buffer
+ *
+ * The add* functions write one cell followed by a comma, the append*
+ * functions write without a separator for composite cells. Nothing is ever
+ * allocated; if the buffer fills up the row is truncated and overflow() is
+ * set. The buffer is always null terminated.
+ */
+class CsvWriter {
+ private:
+  char* buffer;
+  size_t capacity;
+  size_t length;
+  bool overflowed;
+
+  void put(char c);
+  void put(const char* str, size_t len);
+  void putUInt64(uint64_t value);
+
+ public:
+  CsvWriter(char* buffer, size_t capacity);
+
+  void clear();
+  const char* c_str() const { return this->buffer; }
+  size_t size() const { return this->length; }
+  bool overflow() const { return this->overflowed; }
+
+  CsvWriter& appendChar(char c);
+  CsvWriter& appendRaw(const char* str);
+  CsvWriter& appendRaw(const char* str, size_t len);
+  CsvWriter& appendInt(int32_t value);
+  CsvWriter& appendUInt(uint32_t value);
+  CsvWriter& appendHex(uint32_t value);
+  CsvWriter& appendFloat(double value, uint8_t precision = 2);
+  CsvWriter& appendFloatShortest(float value);
+
+  CsvWriter& addInt(int32_t value);
+  CsvWriter& addUInt(uint32_t value);
+  CsvWriter& addHex(uint32_t value);
+  CsvWriter& addFloat(double value, uint8_t precision = 2);
+  CsvWriter& addFloatShortest(float value);
+
+#ifdef ARDUINO
+  CsvWriter& appendRaw(const String& str) {
+    return this->appendRaw(str.c_str(), str.length());
+  }
+#endif
+};
+
+#endif
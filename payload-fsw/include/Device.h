@@ -111,27 +111,45 @@ class Device {
    * @return false If unverified
    */
   bool attemptConnection() {
-    // if it isn't verified and is time to try again
-    // time between tests scales with attempt_number to spread out attempts
-    if (this->verified == false &&
-        (this->max_attempts == -1 ||
-         this->attempt_number < this->max_attempts) &&
-        ((millis() - this->last_attempt) >
-         (this->wait_factor * this->attempt_number))) {
+    if (this->attemptDue()) {
       log_core("Attempt on " + this->device_name);
       // try to verify again
-      this->verified = this->verify();
-      // update record
-      this->last_attempt = millis();
-      if (this->verified) {
-        this->attempt_number = 0;
-      } else {
-        this->attempt_number++;
-      }
+      this->attemptFinished(this->verify());
     }
     // return result
     return this->verified;
   }
+
+ protected:
+  /**
+   * @brief Get if the Device is unverified and it is time to try again, time
+   * between tests scales with attempt_number to spread out attempts
+   *
+   * @return true
+   * @return false
+   */
+  bool attemptDue() {
+    return this->verified == false &&
+           (this->max_attempts == -1 ||
+            this->attempt_number < this->max_attempts) &&
+           ((millis() - this->last_attempt) >
+            (this->wait_factor * this->attempt_number));
+  }
+
+  /**
+   * @brief Records the result of a verification attempt
+   *
+   * @param verified Result of the attempt
+   */
+  void attemptFinished(bool verified) {
+    this->verified = verified;
+    this->last_attempt = millis();
+    if (this->verified) {
+      this->attempt_number = 0;
+    } else {
+      this->attempt_number++;
+    }
+  }
 };
 
 #endif  // DEVICE_H
\ No newline at end of file
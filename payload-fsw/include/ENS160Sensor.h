@@ -26,7 +26,7 @@ class ENS160Sensor : public Sensor {
   bool verify() override;
   String readData() override;
   void readDataPacket(uint8_t*& packet) override;
-  String decodeToCSV(uint8_t*& packet) override;
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,62 @@
+#ifndef FLASH_BACKEND_H
+#define FLASH_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Smallest erasable unit of the QSPI flash */
+#define FLASH_LOG_SECTOR_SIZE 4096
+/** @brief Smallest programmable unit of the QSPI flash */
+#define FLASH_LOG_PAGE_SIZE 256
+
+/**
+ * @brief Raw access to a region of NOR flash, offsets are relative to the
+ * start of the region
+ *
+ * Erasing sets every byte of a sector to 0xFF, programming can only clear
+ * bits. Kept free of Arduino so the log built on top can run on Linux against
+ * SimFlashBackend.
+ */
+class FlashBackend {
+ public:
+  virtual ~FlashBackend() {}
+
+  /**
+   * @brief Get the number of sectors in the region
+   *
+   * @return uint32_t
+   */
+  virtual uint32_t sectorCount() = 0;
+
+  /**
+   * @brief Reads bytes from the region
+   *
+   * @param offset Byte offset into the region
+   * @param dst Buffer to read into
+   * @param len Number of bytes to read
+   * @return true if the read succeeded
+   * @return false otherwise
+   */
+  virtual bool read(uint32_t offset, uint8_t* dst, size_t len) = 0;
+
+  /**
+   * @brief Erases one sector
+   *
+   * @param sector Index of the sector in the region
+   * @return true if the erase succeeded
+   * @return false otherwise
+   */
+  virtual bool eraseSector(uint32_t sector) = 0;
+
+  /**
+   * @brief Programs one page
+   *
+   * @param offset Page aligned byte offset into the region
+   * @param src FLASH_LOG_PAGE_SIZE bytes to program
+   * @return true if the program succeeded
+   * @return false otherwise
+   */
+  virtual bool programPage(uint32_t offset, const uint8_t* src) = 0;
+};
+
+#endif
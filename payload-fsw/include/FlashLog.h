@@ -0,0 +1,93 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FlashBackend.h"
+
+/** @brief Marks a sector header written by FlashLog ("FLOG") */
+#define FLASH_LOG_MAGIC 0x474F4C46
+/** @brief Size of the header at the start of each sector */
+#define FLASH_LOG_HEADER_SIZE 16
+/** @brief Largest packet accepted by the log */
+#define FLASH_LOG_MAX_PACKET 1024
+
+/**
+ * @brief Position of a reader in the log
+ *
+ */
+struct FlashLogCursor {
+  uint32_t sector_index;  // sectors from the oldest
+  uint32_t offset;        // byte offset in the sector
+};
+
+/**
+ * @brief Log-structured packet store on top of a FlashBackend
+ *
+ * Sectors are used as a ring, each starting with a header holding a sequence
+ * number and its erase count, so the ring position survives reboots and wear
+ * spreads evenly over the region. Packets are buffered into pages and
+ * programmed a page at a time; the next sector is erased by maintain() ahead
+ * of time so append() normally only programs. When the ring is full the
+ * oldest sector is overwritten.
+ */
+class FlashLog {
+ private:
+  FlashBackend* flash;
+  uint32_t sector_count;
+  uint32_t* erase_counts;
+
+  // current write position
+  int32_t head_sector;
+  uint32_t head_seq;
+  uint32_t write_offset;
+  uint8_t page[FLASH_LOG_PAGE_SIZE];
+  uint32_t page_fill;
+
+  // sector already erased ahead of the head, -1 if none
+  int32_t erased_sector;
+
+  // counters
+  uint32_t appended_count;
+  uint32_t appended_bytes;
+  uint32_t failed_count;
+  uint32_t inline_erases;
+  uint32_t pre_erases;
+  uint32_t overwritten_sectors;
+
+  bool readHeader(uint32_t sector, uint32_t& seq, uint32_t& erase_count);
+  bool isErased(uint32_t sector, uint32_t from);
+  bool eraseSector(uint32_t sector);
+  bool openSector(uint32_t sector);
+  bool programPage();
+  bool readStream(FlashLogCursor& cursor, uint8_t* dst, size_t len);
+  bool findSync(FlashLogCursor& cursor);
+  uint32_t sectorAt(uint32_t sector_index);
+  uint32_t readEnd(uint32_t sector_index);
+
+ public:
+  FlashLog(FlashBackend& flash);
+  ~FlashLog();
+
+  bool recover();
+  bool append(const uint8_t* data, size_t len);
+  bool flush();
+  bool maintain();
+
+  bool readPacket(FlashLogCursor& cursor, uint8_t* dst, size_t max_len,
+                  uint16_t& packet_len);
+
+  uint32_t pendingBytes() const { return this->page_fill; }
+  uint32_t headSequence() const { return this->head_seq; }
+  uint32_t appendedCount() const { return this->appended_count; }
+  uint32_t appendedBytes() const { return this->appended_bytes; }
+  uint32_t failedCount() const { return this->failed_count; }
+  uint32_t inlineErases() const { return this->inline_erases; }
+  uint32_t preErases() const { return this->pre_erases; }
+  uint32_t overwrittenSectors() const { return this->overwritten_sectors; }
+  uint32_t minEraseCount() const;
+  uint32_t maxEraseCount() const;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef FLASH_STORAGE_H
+#define FLASH_STORAGE_H
+
+#include "FlashLog.h"
+#include "PayloadConfig.h"
+#include "PicoFlashBackend.h"
+#include "Storage.h"
+
+/**
+ * @brief Implementation of a Storage device that keeps a backup packet log in
+ * the Pico's onboard flash
+ *
+ */
+class FlashStorage : public Storage {
+ private:
+  PicoFlashBackend backend;
+  FlashLog flash_log;
+  unsigned long last_append;
+
+ public:
+  FlashStorage();
+  bool verify() override;
+  void store(String data) override;
+  bool storePacket(uint8_t* packet) override;
+  void maintain() override;
+
+  void dump(Print& output);
+  void logFlashStats();
+};
+
+#endif
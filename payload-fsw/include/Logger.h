@@ -28,6 +28,12 @@ static inline void log_data(String data) {
   Serial.print("[Data] " + data + "\n");
 }
 
+static inline void log_data_csv(const char* row, size_t len) {
+  Serial.print("[Data] ");
+  Serial.write(row, len);
+  Serial.print('\n');
+}
+
 // Log flash-related data
 static inline void log_flash(String data) {
   Serial.print("[Flash] " + data + '\n');
@@ -19,7 +19,7 @@ class PCF8523Sensor : public Sensor {
   PCF8523Sensor(unsigned long minimum_period);
 
   bool verify() override;
-  String decodeToCSV(uint8_t*& packet) override;
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
   void readDataPacket(uint8_t*& packet) override;
   String readData() override;
   void calibrate();
@@ -0,0 +1,60 @@
+/**
+ * @file Packet.h
+ * @brief Building, decoding and checking sensor data packets
+ *
+ * Packet layout: sync bytes (4), sensor presence bitmask (4), packet length
+ * (2), millis (4), sensor data (variable), checksum (1)
+ */
+
+#ifndef PACKET_H
+#define PACKET_H
+
+#include <Arduino.h>
+
+#include "CsvWriter.h"
+#include "PayloadConfig.h"
+#include "Sensor.h"
+
+/** @brief Offset of the sensor presence bitmask in a packet */
+#define PACKET_SENSOR_ID_OFFSET (sizeof(SYNC_BYTES))
+/** @brief Offset of the packet length in a packet */
+#define PACKET_LEN_OFFSET (PACKET_SENSOR_ID_OFFSET + sizeof(uint32_t))
+/** @brief Offset of the millis timestamp in a packet */
+#define PACKET_MILLIS_OFFSET (PACKET_LEN_OFFSET + sizeof(uint16_t))
+/** @brief Size of the header before the sensor data */
+#define PACKET_HEADER_SIZE (PACKET_MILLIS_OFFSET + sizeof(uint32_t))
+
+uint16_t readSensorDataPacket(Sensor** sensors, int sensors_len,
+                              uint8_t* packet);
+String decodePacket(Sensor** sensors, int sensors_len, uint8_t* packet);
+size_t decodePacket(Sensor** sensors, int sensors_len, uint8_t* packet,
+                    CsvWriter& csv);
+
+int8_t packetChecksum(const uint8_t* packet, uint16_t packet_len);
+bool packetChecksumValid(const uint8_t* packet, uint16_t packet_len);
+
+/**
+ * @brief Reads the length field of a packet
+ *
+ * @param packet Pointer to the packet bytes
+ * @return uint16_t Length of the packet including the checksum
+ */
+static inline uint16_t packetLength(const uint8_t* packet) {
+  uint16_t packet_len;
+  memcpy(&packet_len, packet + PACKET_LEN_OFFSET, sizeof(packet_len));
+  return packet_len;
+}
+
+/**
+ * @brief Reads the millis timestamp of a packet
+ *
+ * @param packet Pointer to the packet bytes
+ * @return uint32_t Millis at the time the packet was built
+ */
+static inline uint32_t packetMillis(const uint8_t* packet) {
+  uint32_t packet_millis;
+  memcpy(&packet_millis, packet + PACKET_MILLIS_OFFSET, sizeof(packet_millis));
+  return packet_millis;
+}
+
+#endif
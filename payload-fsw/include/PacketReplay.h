@@ -0,0 +1,43 @@
+#ifndef PACKET_REPLAY_H
+#define PACKET_REPLAY_H
+
+#include <Arduino.h>
+
+#include "Packet.h"
+#include "PayloadConfig.h"
+#include "SD.h"
+
+/**
+ * @brief Reads packets back out of a recorded RAWDATA file so they can be
+ * pushed through the core 1 storage and decode path
+ *
+ * Packets are paced by their recorded millis, scaled by time_scale (2.0 plays
+ * back twice as fast, 0 plays back as fast as possible).
+ */
+class PacketReplay {
+ private:
+  File source;
+  float time_scale;
+
+  uint8_t pending[QT_ENTRY_SIZE];
+  uint16_t pending_len;
+
+  uint32_t first_packet_millis;
+  uint32_t replay_start_millis;
+  bool started;
+
+  uint32_t packets_replayed;
+  uint32_t packets_rejected;
+  uint32_t bytes_replayed;
+
+  uint16_t readPacket(uint8_t* packet);
+
+ public:
+  PacketReplay(float time_scale);
+  bool begin(const String& file_name);
+  uint16_t nextPacket(uint8_t* packet);
+  bool done();
+  void logStats();
+};
+
+#endif
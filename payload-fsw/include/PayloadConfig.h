@@ -66,6 +66,13 @@
 /** @brief CAN CS Pin */
 #define CAN_CS 13
 
+/** @brief Time a partially filled flash page waits before being programmed
+ * (ms) */
+#define FLASH_STORAGE_FLUSH_MS 2000
+/** @brief Toggle copying the flash packet log to FLASHLOG.BIN on the SD card
+ * at boot */
+#define FLASH_STORAGE_DUMP 0
+
 /** @brief SD Card SPI Toggle */
 #define SD_SPI1 0
 /** @brief SD Card SPI CS Pin */
@@ -83,10 +90,42 @@
 #define QT_ENTRY_SIZE 500
 #define QT_MAX_SIZE 10
 
+// per storage queues
+/** @brief Packets each storage can hold while it is slow or reverifying */
+#define STORAGE_QUEUE_LEN 8
+/** @brief Most packets one storage writes per core 1 loop before yielding */
+#define STORAGE_DRAIN_BUDGET 4
+/** @brief Time after which a storage starts no new write in a core 1 loop
+ * (us) */
+#define STORAGE_DRAIN_BUDGET_US 5000
+/** @brief Period between storage throughput logs (ms) */
+#define STORAGE_STATS_LOG_PERIOD 10000
+
+/** @brief Largest decoded CSV row, used for the fixed row buffers */
+#define CSV_ROW_MAX_SIZE 1024
+/** @brief Toggle printing decoded CSV rows over Serial instead of raw packets */
+#define SERIAL_LIVE_CSV 0
+
+// packet replay
+/** @brief Toggle replaying a recorded packet file from the SD card through the
+ * core 1 storage and decode path, live packets are dropped while replaying */
+#define PACKET_REPLAY 0
+/** @brief Recorded packet file to replay (a copied RAWDATA*.BIN) */
+#define PACKET_REPLAY_FILE "REPLAY.BIN"
+/** @brief Replay speed relative to the recording, 0 for max speed */
+#define PACKET_REPLAY_TIME_SCALE 1.0f
+/** @brief Number of replayed packets between throughput logs */
+#define PACKET_REPLAY_LOG_PERIOD 100
+
 // packet properties
 const uint8_t SYNC_BYTES[] = {'A', 'S', 'U', '!'};
 
 // temporary toggle macros for testing
 #define PACKET_SYSTEM_TESTING 1
 
+/** @brief Toggle per-packet debug prints (disabled for benchmark builds) */
+#ifndef PACKET_DEBUG_LOG
+#define PACKET_DEBUG_LOG 1
+#endif
+
 #endif
@@ -0,0 +1,29 @@
+#ifndef PICO_FLASH_BACKEND_H
+#define PICO_FLASH_BACKEND_H
+
+#include <Arduino.h>
+
+#include "FlashBackend.h"
+
+/**
+ * @brief FlashBackend over the Pico's QSPI flash, using the region reserved by
+ * board_build.filesystem_size in platformio.ini
+ *
+ * Erase and program stall the other core and interrupts for their duration
+ * since code runs from the same flash.
+ */
+class PicoFlashBackend : public FlashBackend {
+ private:
+  uint32_t region_offset;
+  uint32_t sector_count;
+
+ public:
+  PicoFlashBackend();
+
+  uint32_t sectorCount() override { return this->sector_count; }
+  bool read(uint32_t offset, uint8_t* dst, size_t len) override;
+  bool eraseSector(uint32_t sector) override;
+  bool programPage(uint32_t offset, const uint8_t* src) override;
+};
+
+#endif
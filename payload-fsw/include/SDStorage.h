@@ -6,6 +6,28 @@
 #include "SD.h"
 #include "Storage.h"
 
+// log file naming
+#if STORING_PACKETS
+#define SD_FILE_PREFIX "RAWDATA"
+#define SD_FILE_SUFFIX ".BIN"
+#else
+#define SD_FILE_PREFIX "DATA"
+#define SD_FILE_SUFFIX ".CSV"
+#endif
+/** @brief Control file holding the number of the next log file */
+#define SD_BOOT_COUNT_FILE "BOOT.CNT"
+
+/**
+ * @brief Steps of an SD card verification, each one a single short blocking
+ * call
+ *
+ */
+enum class SDVerifyState {
+  BEGIN,      // start the card
+  PICK_FILE,  // pick the log file for this boot
+  OPEN_FILE   // check the log file opens
+};
+
 /**
  * @brief Implementation of a Storage device to interface with an SD card
  *
@@ -13,6 +35,11 @@
 class SDStorage : public Storage {
  private:
   String file_name;
+  SDVerifyState verify_state = SDVerifyState::BEGIN;
+
+  int nextFileNumber();
+  int scanFileNumber();
+  void saveBootCount(int next_num);
 #if SD_SPI1
   SPIClassRP2040 sd_spi_1 = SPIClassRP2040(spi1, SPI1_MISO_PIN, SD_CS_PIN,
                                            SPI1_SCK_PIN, SPI1_MOSI_PIN);
@@ -21,8 +48,9 @@ class SDStorage : public Storage {
  public:
   SDStorage();
   bool verify() override;
+  VerifyStatus verifyStep() override;
   void store(String data) override;
-  void storePacket(uint8_t* packet) override;
+  bool storePacket(uint8_t* packet) override;
 };
 
 #endif
\ No newline at end of file
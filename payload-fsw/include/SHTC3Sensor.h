@@ -22,7 +22,7 @@ class SHTC3Sensor : public Sensor {
   String readData() override;
 
   void readDataPacket(uint8_t*& packet) override;
-  String decodeToCSV(uint8_t*& packet) override;
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
 
   float getRelHum();
 };
@@ -3,8 +3,10 @@
 
 #include <Arduino.h>
 
+#include "CsvWriter.h"
 #include "Device.h"
 #include "Logger.h"
+#include "PayloadConfig.h"
 
 /**
  * @brief Parent class for sensor objects
@@ -120,15 +122,29 @@ class Sensor : public Device {
    */
   virtual void readDataPacket(uint8_t*& packet) {};
 
+  /**
+   * @brief Used for onboard decoding of packets, writes the sensor's cells
+   * straight into the row without allocating
+   *
+   * @param packet Pointer to the packet byte array
+   * @param csv Row to append the decoded cells to
+   */
+  virtual void decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
+    csv.appendChar('(').appendRaw(this->getDeviceName()).appendRaw(" data), ");
+  };
+
   /**
    * @brief Used for onboard decoding of packets
    *
    * @param packet  Pointer to the packet byte array
    * @return String The senors data decoded from the packet in csv format
    */
-  virtual String decodeToCSV(uint8_t*& packet) {
-    return "(" + this->getDeviceName() + " data), ";
-  };
+  String decodeToCSV(uint8_t*& packet) {
+    char row[CSV_ROW_MAX_SIZE];
+    CsvWriter csv(row, sizeof(row));
+    this->decodeToCSV(packet, csv);
+    return String(row);
+  }
 
   /**
    * @brief Append the data from a sensor to the packet if the minium period is
@@ -157,9 +173,9 @@ class Sensor : public Device {
    * @brief Returns CSV line in the same format as readData() but with "-"
    * instead of data
    *
-   * @return String
+   * @return const String&
    */
-  String readEmpty() const { return this->empty_csv; }
+  const String& readEmpty() const { return this->empty_csv; }
 
   /**
    * @brief Uses readData and readEmpty to get the data-filled or empty-celled
@@ -0,0 +1,52 @@
+#ifndef SIM_FLASH_BACKEND_H
+#define SIM_FLASH_BACKEND_H
+
+#include "FlashBackend.h"
+
+/**
+ * @brief RAM backed NOR flash simulator for exercising FlashLog on Linux
+ *
+ * Enforces erase-before-program, accumulates simulated erase and program
+ * time, and can cut power partway through an operation: the interrupted
+ * program or erase is left half done and every operation fails until
+ * powerOn() is called.
+ */
+class SimFlashBackend : public FlashBackend {
+ private:
+  uint8_t* memory;
+  uint32_t sector_count;
+  uint32_t* erase_counts;
+
+  uint32_t erase_us;
+  uint32_t program_us;
+  uint64_t elapsed_us;
+  uint32_t longest_op_us;
+
+  // operations left before the power cut, -1 for never
+  int32_t ops_until_cut;
+  bool powered;
+
+  bool takeOp();
+
+ public:
+  SimFlashBackend(uint32_t sector_count, uint32_t erase_us = 45000,
+                  uint32_t program_us = 700);
+  ~SimFlashBackend();
+
+  uint32_t sectorCount() override { return this->sector_count; }
+  bool read(uint32_t offset, uint8_t* dst, size_t len) override;
+  bool eraseSector(uint32_t sector) override;
+  bool programPage(uint32_t offset, const uint8_t* src) override;
+
+  void cutPowerAfter(int32_t ops);
+  void powerOn();
+  bool isPowered() const { return this->powered; }
+
+  uint64_t elapsedUs() const { return this->elapsed_us; }
+  uint32_t longestOpUs() const { return this->longest_op_us; }
+  uint32_t eraseCount(uint32_t sector) const {
+    return this->erase_counts[sector];
+  }
+};
+
+#endif
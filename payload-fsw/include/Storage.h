@@ -5,13 +5,53 @@
 
 #include "Device.h"
 #include "Logger.h"
+#include "PayloadConfig.h"
+#include "pico/util/queue.h"
+
+/**
+ * @brief What a Storage does with a new packet when its queue is full
+ *
+ */
+enum class DropPolicy {
+  DROP_NEWEST,  // keep the backlog, discard the incoming packet
+  DROP_OLDEST   // discard the oldest queued packet to make room
+};
+
+/**
+ * @brief Result of one step of a storage verification
+ *
+ */
+enum class VerifyStatus {
+  VERIFY_PENDING,  // call verifyStep() again
+  VERIFY_DONE,
+  VERIFY_FAILED
+};
 
 /**
  * @brief Parent class for all data storage devices (sd card, radio, etc)
  *
+ * Each storage owns a bounded packet queue. Core 1 fans every packet out to
+ * all the queues with enqueuePacket(), then drains each queue within a packet
+ * and time budget. Reverification is split into short steps run one per core
+ * 1 loop by stepVerify(), so a slow, failing or reverifying storage only
+ * fills its own queue and delays the others by at most one budget.
  */
 class Storage : public Device {
  private:
+  queue_t packet_queue;
+  uint packet_queue_len = 0;
+  DropPolicy drop_policy = DropPolicy::DROP_NEWEST;
+  uint8_t drain_buffer[QT_ENTRY_SIZE];
+
+  // throughput counters
+  uint32_t enqueued_count = 0;
+  uint32_t stored_count = 0;
+  uint32_t dropped_count = 0;
+  uint32_t stored_bytes = 0;
+  uint32_t drain_us = 0;
+
+  bool verifying = false;  // a stepped verification is in progress
+
  public:
   Storage(String storage_name) : Device(storage_name) {}
 
@@ -23,6 +63,17 @@ class Storage : public Device {
    */
   virtual bool verify() = 0;
 
+  /**
+   * @brief Runs the next short step of a verification, storages with a slow
+   * verify() split it up so core 1 keeps draining the other storages
+   *
+   * @return VerifyStatus VERIFY_PENDING until the verification finishes
+   */
+  virtual VerifyStatus verifyStep() {
+    return this->verify() ? VerifyStatus::VERIFY_DONE
+                          : VerifyStatus::VERIFY_FAILED;
+  }
+
   /**
    * @brief Send string data to storage device
    *
@@ -33,9 +84,144 @@ class Storage : public Device {
   /**
    * @brief Send packet data to storage device
    *
-   * @param packet Packet to store
+   * @param packet Packet to store, its length already checked
+   * @return true if the packet was written
+   * @return false if it should stay queued for a retry
+   */
+  virtual bool storePacket(uint8_t* packet) { return true; };
+
+  /**
+   * @brief Background work done while core 1 is idle, ex: pre-erasing flash
+   *
+   */
+  virtual void maintain() {};
+
+  /**
+   * @brief Allocates the packet queue, must be called before enqueuePacket()
+   *
+   * @param queue_len Number of packets the queue holds
+   * @param drop_policy What to drop when the queue is full
+   */
+  void queueConfig(uint queue_len, DropPolicy drop_policy) {
+    if (this->packet_queue_len == 0) {
+      queue_init(&this->packet_queue, QT_ENTRY_SIZE, queue_len);
+      this->packet_queue_len = queue_len;
+    }
+    this->drop_policy = drop_policy;
+  }
+
+  /**
+   * @brief Queues a packet for this storage without writing it
+   *
+   * @param packet Packet of QT_ENTRY_SIZE bytes
+   * @return true if the packet was queued
+   * @return false if it was dropped
+   */
+  bool enqueuePacket(const uint8_t* packet) {
+    if (this->packet_queue_len == 0) return false;
+
+    if (queue_is_full(&this->packet_queue)) {
+      this->dropped_count++;
+      if (this->drop_policy == DropPolicy::DROP_NEWEST) return false;
+      queue_try_remove(&this->packet_queue, this->drain_buffer);
+    }
+
+    if (!queue_try_add(&this->packet_queue, packet)) {
+      this->dropped_count++;
+      return false;
+    }
+    this->enqueued_count++;
+    return true;
+  }
+
+  /**
+   * @brief Runs one step of reverifying an unverified storage, with the same
+   * backoff as attemptConnection() but without blocking for the whole verify
+   *
+   * @return true if verified
+   * @return false otherwise
+   */
+  bool stepVerify() {
+    if (this->verified) return true;
+    if (!this->verifying) {
+      if (!this->attemptDue()) return false;
+      log_core("Attempt on " + this->device_name);
+      this->verifying = true;
+    }
+
+    VerifyStatus status = this->verifyStep();
+    if (status == VerifyStatus::VERIFY_PENDING) return false;
+    this->verifying = false;
+    this->attemptFinished(status == VerifyStatus::VERIFY_DONE);
+    return this->verified;
+  }
+
+  /**
+   * @brief Writes queued packets until the packet or time budget runs out, a
+   * packet stays queued until it is written so none are lost while the
+   * storage is unverified
+   *
+   * @param budget Maximum number of packets to write this call
+   * @param budget_us Time after which no new write is started, one slow write
+   * can still run over
+   * @return int Number of packets written
+   */
+  int drain(int budget, uint32_t budget_us) {
+    if (this->packet_queue_len == 0 || queue_is_empty(&this->packet_queue)) {
+      return 0;
+    }
+    if (!this->verified) return 0;
+
+    int count = 0;
+    uint32_t start = micros();
+    while (count < budget && micros() - start < budget_us &&
+           queue_try_peek(&this->packet_queue, this->drain_buffer)) {
+      uint16_t packet_len;
+      memcpy(&packet_len,
+             this->drain_buffer + sizeof(SYNC_BYTES) + sizeof(uint32_t),
+             sizeof(packet_len));
+
+      // a corrupt length would never write, don't let it block the queue
+      if (packet_len >= QT_ENTRY_SIZE) {
+        queue_try_remove(&this->packet_queue, this->drain_buffer);
+        this->dropped_count++;
+        continue;
+      }
+
+      // retried next drain, the write may also have flagged a reverification
+      if (!this->storePacket(this->drain_buffer)) break;
+
+      queue_try_remove(&this->packet_queue, this->drain_buffer);
+      this->stored_count++;
+      this->stored_bytes += packet_len;
+      count++;
+    }
+    this->drain_us += micros() - start;
+    return count;
+  }
+
+  /**
+   * @brief Get the number of packets waiting in the queue
+   *
+   * @return uint
+   */
+  uint queueLevel() {
+    if (this->packet_queue_len == 0) return 0;
+    return queue_get_level(&this->packet_queue);
+  }
+
+  /**
+   * @brief Logs the queue and throughput counters
+   *
    */
-  virtual void storePacket(uint8_t* packet) {};
+  void logStats() {
+    log_core_printf(
+        "%s: queued %lu, stored %lu (%lu B, %lu us), dropped %lu, level %u\n",
+        this->device_name.c_str(), (unsigned long)this->enqueued_count,
+        (unsigned long)this->stored_count, (unsigned long)this->stored_bytes,
+        (unsigned long)this->drain_us, (unsigned long)this->dropped_count,
+        this->queueLevel());
+  }
 };
 
-#endif
\ No newline at end of file
+#endif
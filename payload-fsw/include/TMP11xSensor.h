@@ -27,7 +27,7 @@ class TMP11xSensor : public Sensor {
   void readDataPacket(uint8_t*& packet);
 
   // Function to decode sensor data from a packet and return a CSV string
-  String decodeToCSV(uint8_t*& packet);
+  void decodeToCSV(uint8_t*& packet, CsvWriter& csv) override;
 
   float getTempC();
 };
@@ -72,9 +72,9 @@ void AS7331Sensor::readDataPacket(uint8_t*& packet) {
  * @brief Decodes a packet into a CSV string
  *
  * @param packet The packet to decode
- * @return String CSV line - UVA, UVB, UVC,
+ * @param csv Row to append the CSV cells to - UVA, UVB, UVC,
  */
-String AS7331Sensor::decodeToCSV(uint8_t*& packet) {
+void AS7331Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   float uva, uvb, uvc;
   std::copy(packet, packet + sizeof(uva), (uint8_t*)(&uva));
   packet += sizeof(uva);
@@ -83,5 +83,5 @@ String AS7331Sensor::decodeToCSV(uint8_t*& packet) {
   std::copy(packet, packet + sizeof(uvc), (uint8_t*)(&uvc));
   packet += sizeof(uvc);
 
-  return String(uva) + "," + String(uvb) + "," + String(uvc) + ",";
+  csv.addFloat(uva).addFloat(uvb).addFloat(uvc);
 }
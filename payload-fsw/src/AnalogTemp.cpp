@@ -51,14 +51,14 @@ void AnalogTemp::readDataPacket(uint8_t*& packet) {
  * @brief Decodes ADC reading from packet array
  *
  * @param packet Pointer to the packet byte array
- * @return String ADC reading
+ * @param csv Row to append the ADC reading to
  */
-String AnalogTemp::decodeToCSV(uint8_t*& packet) {
+void AnalogTemp::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   int adc_reading = 0;
 
   memcpy(&adc_reading, packet, sizeof(int));
 
   packet += sizeof(int);
 
-  return String(adc_reading);
+  csv.appendInt(adc_reading);
 }
\ No newline at end of file
@@ -99,9 +99,9 @@ void BME688Sensor::readDataPacket(uint8_t*& packet) {
  * @brief Decodes BME688 data from packet to CSV
  *
  * @param packet Pointer to packet bytes
- * @return String CSV stub of temperature, pressure, humidity, and gas values
+ * @param csv Row to append temperature, pressure, humidity, and gas values to
  */
-String BME688Sensor::decodeToCSV(uint8_t*& packet) {
+void BME688Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   float temp = 0;
   uint32_t pressure = 0;
   float humidity = 0;
@@ -119,6 +119,8 @@ String BME688Sensor::decodeToCSV(uint8_t*& packet) {
   memcpy(&gas_resistance, packet, sizeof(gas_resistance));
   packet += sizeof(gas_resistance);
 
-  return String(temp, 5) + "," + String(pressure) + "," + String(humidity, 5) +
-         "," + String(gas_resistance) + ",";
+  csv.addFloat(temp, 5)
+      .addUInt(pressure)
+      .addFloat(humidity, 5)
+      .addUInt(gas_resistance);
 }
@@ -92,9 +92,9 @@ void BMP390Sensor::readDataPacket(uint8_t*& packet) {
  * @brief Decodes data from the packet
  *
  * @param packet Pointer to decode at
- * @return String CSV stub Temperature, Pressure,
+ * @param csv Row to append Temperature, Pressure, Altitude to
  */
-String BMP390Sensor::decodeToCSV(uint8_t*& packet) {
+void BMP390Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   double temperature = 0;
   double pressure = 0;
   float alt = 0;
@@ -108,6 +108,5 @@ String BMP390Sensor::decodeToCSV(uint8_t*& packet) {
   memcpy(&alt, packet, sizeof(alt));
   packet += sizeof(alt);
 
-  return String(temperature, 5) + "," + String(pressure, 5) + "," +
-         String(alt, 5);
+  csv.addFloat(temperature, 5).addFloat(pressure, 5).appendFloat(alt, 5);
 }
\ No newline at end of file
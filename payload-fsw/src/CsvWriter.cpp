@@ -0,0 +1,223 @@
+#include "CsvWriter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/** @brief Highest number of decimal places supported for fixed precision */
+#define CSV_MAX_PRECISION 9
+/** @brief Highest number of decimal places tried for shortest round trip */
+#define CSV_MAX_SHORTEST_PRECISION 12
+
+static const uint64_t POW10[] = {
+    1ULL,          10ULL,          100ULL,          1000ULL,
+    10000ULL,      100000ULL,      1000000ULL,      10000000ULL,
+    100000000ULL,  1000000000ULL,  10000000000ULL,  100000000000ULL,
+    1000000000000ULL};
+
+/**
+ * @brief Construct a new CsvWriter object over a fixed buffer
+ *
+ * @param buffer Buffer to write the row into
+ * @param capacity Size of the buffer including the null terminator
+ */
+CsvWriter::CsvWriter(char* buffer, size_t capacity) {
+  this->buffer = buffer;
+  this->capacity = capacity;
+  this->clear();
+}
+
+/**
+ * @brief Empties the row so the buffer can be reused
+ *
+ */
+void CsvWriter::clear() {
+  this->length = 0;
+  this->overflowed = (this->capacity == 0);
+  if (this->capacity > 0) this->buffer[0] = '\0';
+}
+
+void CsvWriter::put(char c) {
+  if (this->length + 1 >= this->capacity) {
+    this->overflowed = true;
+    return;
+  }
+  this->buffer[this->length++] = c;
+  this->buffer[this->length] = '\0';
+}
+
+void CsvWriter::put(const char* str, size_t len) {
+  if (this->length + len >= this->capacity) {
+    this->overflowed = true;
+    if (this->capacity == 0) return;
+    len = this->capacity - 1 - this->length;
+  }
+  memcpy(this->buffer + this->length, str, len);
+  this->length += len;
+  this->buffer[this->length] = '\0';
+}
+
+void CsvWriter::putUInt64(uint64_t value) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + (value % 10);
+    value /= 10;
+  } while (value != 0);
+
+  char out[20];
+  for (size_t i = 0; i < n; i++) out[i] = digits[n - 1 - i];
+  this->put(out, n);
+}
+
+CsvWriter& CsvWriter::appendChar(char c) {
+  this->put(c);
+  return *this;
+}
+
+CsvWriter& CsvWriter::appendRaw(const char* str) {
+  this->put(str, strlen(str));
+  return *this;
+}
+
+CsvWriter& CsvWriter::appendRaw(const char* str, size_t len) {
+  this->put(str, len);
+  return *this;
+}
+
+CsvWriter& CsvWriter::appendInt(int32_t value) {
+  int64_t wide = value;
+  if (wide < 0) {
+    this->put('-');
+    wide = -wide;
+  }
+  this->putUInt64((uint64_t)wide);
+  return *this;
+}
+
+CsvWriter& CsvWriter::appendUInt(uint32_t value) {
+  this->putUInt64(value);
+  return *this;
+}
+
+CsvWriter& CsvWriter::appendHex(uint32_t value) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  char out[8];
+  size_t n = 0;
+  for (int shift = 28; shift >= 0; shift -= 4) {
+    uint8_t nibble = (value >> shift) & 0xF;
+    if (nibble == 0 && n == 0 && shift != 0) continue;  // skip leading zeros
+    out[n++] = HEX_DIGITS[nibble];
+  }
+  this->put(out, n);
+  return *this;
+}
+
+/**
+ * @brief Writes a float with a fixed number of decimal places, matching
+ * String(value, precision) without going through printf
+ *
+ * @param value Value to write
+ * @param precision Decimal places, capped at 9
+ * @return CsvWriter&
+ */
+CsvWriter& CsvWriter::appendFloat(double value, uint8_t precision) {
+  if (isnan(value)) return this->appendRaw("nan");
+  if (isinf(value)) return this->appendRaw(value < 0 ? "-inf" : "inf");
+  if (precision > CSV_MAX_PRECISION) precision = CSV_MAX_PRECISION;
+
+  // exact for float inputs, a float mantissa times 10^9 fits in a double
+  double scaled = fabs(value) * (double)POW10[precision];
+  if (scaled >= 1.8e19) {
+    // too large for the integer path
+    char out[64];
+    int len = snprintf(out, sizeof(out), "%.*f", precision, value);
+    if (len > 0) this->put(out, (size_t)len < sizeof(out) ? len : 63);
+    return *this;
+  }
+
+  // round half to even like printf
+  uint64_t whole = (uint64_t)scaled;
+  double remainder = scaled - (double)whole;
+  if (remainder > 0.5 || (remainder == 0.5 && (whole & 1))) whole++;
+
+  if (signbit(value)) this->put('-');
+  this->putUInt64(whole / POW10[precision]);
+
+  if (precision > 0) {
+    // fraction with leading zeros
+    uint64_t frac = whole % POW10[precision];
+    char out[CSV_MAX_PRECISION + 1];
+    out[0] = '.';
+    for (int i = precision; i > 0; i--) {
+      out[i] = '0' + (frac % 10);
+      frac /= 10;
+    }
+    this->put(out, precision + 1);
+  }
+  return *this;
+}
+
+/**
+ * @brief Writes the fewest decimal places that still parse back to exactly
+ * the same float
+ *
+ * @param value Value to write
+ * @return CsvWriter&
+ */
+CsvWriter& CsvWriter::appendFloatShortest(float value) {
+  if (isnan(value)) return this->appendRaw("nan");
+  if (isinf(value)) return this->appendRaw(value < 0 ? "-inf" : "inf");
+
+  float magnitude = fabsf(value);
+  if (magnitude == 0.0f) return this->appendRaw(signbit(value) ? "-0" : "0");
+
+  if (magnitude < 1e9f) {
+    for (uint8_t p = 0; p <= CSV_MAX_SHORTEST_PRECISION; p++) {
+      double scaled = (double)magnitude * (double)POW10[p];
+      if (scaled >= 1e18) break;
+      uint64_t whole = (uint64_t)(scaled + 0.5);
+      if ((float)((double)whole / (double)POW10[p]) == magnitude) {
+        if (value < 0) this->put('-');
+        this->putUInt64(whole / POW10[p]);
+        if (p > 0) {
+          uint64_t frac = whole % POW10[p];
+          char out[CSV_MAX_SHORTEST_PRECISION + 1];
+          out[0] = '.';
+          for (int i = p; i > 0; i--) {
+            out[i] = '0' + (frac % 10);
+            frac /= 10;
+          }
+          this->put(out, p + 1);
+        }
+        return *this;
+      }
+    }
+  }
+
+  // very large or very small values, 9 significant digits always round trip
+  char out[32];
+  int len = snprintf(out, sizeof(out), "%.9g", value);
+  if (len > 0) this->put(out, len);
+  return *this;
+}
+
+CsvWriter& CsvWriter::addInt(int32_t value) {
+  return this->appendInt(value).appendChar(',');
+}
+
+CsvWriter& CsvWriter::addUInt(uint32_t value) {
+  return this->appendUInt(value).appendChar(',');
+}
+
+CsvWriter& CsvWriter::addHex(uint32_t value) {
+  return this->appendHex(value).appendChar(',');
+}
+
+CsvWriter& CsvWriter::addFloat(double value, uint8_t precision) {
+  return this->appendFloat(value, precision).appendChar(',');
+}
+
+CsvWriter& CsvWriter::addFloatShortest(float value) {
+  return this->appendFloatShortest(value).appendChar(',');
+}
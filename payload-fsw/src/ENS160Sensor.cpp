@@ -116,7 +116,7 @@ void ENS160Sensor::readDataPacket(uint8_t*& packet) {
   this->setCompensations();
 }
 
-String ENS160Sensor::decodeToCSV(uint8_t*& packet) {
+void ENS160Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   uint8_t aqi = *packet;
   packet += sizeof(uint8_t);
 
@@ -128,5 +128,5 @@ String ENS160Sensor::decodeToCSV(uint8_t*& packet) {
   memcpy(&eco2, packet, sizeof(uint16_t));
   packet += sizeof(uint16_t);
 
-  return String(aqi) + "," + String(tvoc) + "," + String(eco2) + ",";
+  csv.addUInt(aqi).addUInt(tvoc).addUInt(eco2);
 }
\ No newline at end of file
@@ -0,0 +1,461 @@
+#include "FlashLog.h"
+
+#include <string.h>
+
+// packet framing, matches Packet.h
+static const uint8_t PACKET_SYNC[] = {'A', 'S', 'U', '!'};
+static const uint32_t PACKET_LEN_POS = 8;
+static const uint32_t PACKET_MIN_LEN = 15;
+
+/**
+ * @brief Construct a new FlashLog object, recover() must be called before use
+ *
+ * @param flash Region to keep the log in
+ */
+FlashLog::FlashLog(FlashBackend& flash) {
+  this->flash = &flash;
+  this->sector_count = 0;
+  this->erase_counts = nullptr;
+
+  this->head_sector = -1;
+  this->head_seq = 0;
+  this->write_offset = 0;
+  this->page_fill = 0;
+  this->erased_sector = -1;
+
+  this->appended_count = 0;
+  this->appended_bytes = 0;
+  this->failed_count = 0;
+  this->inline_erases = 0;
+  this->pre_erases = 0;
+  this->overwritten_sectors = 0;
+}
+
+FlashLog::~FlashLog() { delete[] this->erase_counts; }
+
+/**
+ * @brief Reads and checks a sector header
+ *
+ * @param sector Sector to read
+ * @param seq Sequence number of the sector
+ * @param erase_count Erase count of the sector
+ * @return true if the header is valid
+ * @return false if the sector is erased, torn or not part of the log
+ */
+bool FlashLog::readHeader(uint32_t sector, uint32_t& seq,
+                          uint32_t& erase_count) {
+  uint32_t header[FLASH_LOG_HEADER_SIZE / sizeof(uint32_t)];
+  if (!this->flash->read(sector * FLASH_LOG_SECTOR_SIZE, (uint8_t*)header,
+                         sizeof(header))) {
+    return false;
+  }
+  if (header[0] != FLASH_LOG_MAGIC) return false;
+  if (header[3] != ~(header[0] ^ header[1] ^ header[2])) return false;
+  seq = header[1];
+  erase_count = header[2];
+  return true;
+}
+
+/**
+ * @brief Checks that a sector reads back as erased
+ *
+ * @param sector Sector to check
+ * @param from Byte offset in the sector to start checking at
+ * @return true if every byte from the offset on is 0xFF
+ * @return false otherwise
+ */
+bool FlashLog::isErased(uint32_t sector, uint32_t from) {
+  uint8_t chunk[64];
+  for (uint32_t offset = from; offset < FLASH_LOG_SECTOR_SIZE;
+       offset += sizeof(chunk)) {
+    if (!this->flash->read(sector * FLASH_LOG_SECTOR_SIZE + offset, chunk,
+                           sizeof(chunk))) {
+      return false;
+    }
+    for (size_t i = 0; i < sizeof(chunk); i++) {
+      if (chunk[i] != 0xFF) return false;
+    }
+  }
+  return true;
+}
+
+bool FlashLog::eraseSector(uint32_t sector) {
+  uint32_t seq, erase_count;
+  if (this->readHeader(sector, seq, erase_count)) this->overwritten_sectors++;
+  if (!this->flash->eraseSector(sector)) return false;
+  this->erase_counts[sector]++;
+  return true;
+}
+
+/**
+ * @brief Makes a sector the head of the log, erasing it first unless
+ * maintain() already did
+ *
+ * @param sector Sector to open
+ * @return true if the sector is ready to program
+ * @return false if the erase failed
+ */
+bool FlashLog::openSector(uint32_t sector) {
+  if ((int32_t)sector != this->erased_sector) {
+    if (!this->eraseSector(sector)) return false;
+    this->inline_erases++;
+  }
+  this->erased_sector = -1;
+
+  this->head_sector = sector;
+  this->head_seq++;
+  this->write_offset = 0;
+
+  // the header goes out with the first page of data
+  memset(this->page, 0xFF, sizeof(this->page));
+  uint32_t header[FLASH_LOG_HEADER_SIZE / sizeof(uint32_t)];
+  header[0] = FLASH_LOG_MAGIC;
+  header[1] = this->head_seq;
+  header[2] = this->erase_counts[sector];
+  header[3] = ~(header[0] ^ header[1] ^ header[2]);
+  memcpy(this->page, header, sizeof(header));
+  this->page_fill = FLASH_LOG_HEADER_SIZE;
+  return true;
+}
+
+/**
+ * @brief Programs the page buffer at the write position, the unused end of the
+ * page stays erased
+ *
+ * @return true if the program succeeded
+ * @return false otherwise
+ */
+bool FlashLog::programPage() {
+  bool ok = this->flash->programPage(
+      this->head_sector * FLASH_LOG_SECTOR_SIZE + this->write_offset,
+      this->page);
+  // never program the same page twice, even if this one failed
+  this->write_offset += FLASH_LOG_PAGE_SIZE;
+  this->page_fill = 0;
+  memset(this->page, 0xFF, sizeof(this->page));
+  return ok;
+}
+
+/**
+ * @brief Scans the region for the newest sector and resumes writing after its
+ * last programmed page
+ *
+ * @return true if the region could be read
+ * @return false otherwise
+ */
+bool FlashLog::recover() {
+  if (this->sector_count == 0) {
+    this->sector_count = this->flash->sectorCount();
+    this->erase_counts = new uint32_t[this->sector_count]();
+  }
+  if (this->sector_count < 2) return false;
+
+  uint8_t probe;
+  if (!this->flash->read(0, &probe, 1)) return false;
+
+  this->head_sector = -1;
+  this->head_seq = 0;
+  this->write_offset = 0;
+  this->page_fill = 0;
+  this->erased_sector = -1;
+  memset(this->page, 0xFF, sizeof(this->page));
+
+  // newest sector by sequence number
+  uint32_t max_erase_count = 0;
+  for (uint32_t s = 0; s < this->sector_count; s++) {
+    uint32_t seq, erase_count;
+    if (this->readHeader(s, seq, erase_count)) {
+      this->erase_counts[s] = erase_count;
+      if (erase_count > max_erase_count) max_erase_count = erase_count;
+      if (this->head_sector < 0 || seq > this->head_seq) {
+        this->head_sector = s;
+        this->head_seq = seq;
+      }
+    } else {
+      this->erase_counts[s] = UINT32_MAX;
+    }
+  }
+
+  // sectors without a header lost their count, assume the worst known
+  for (uint32_t s = 0; s < this->sector_count; s++) {
+    if (this->erase_counts[s] == UINT32_MAX) {
+      this->erase_counts[s] = max_erase_count;
+    }
+  }
+
+  if (this->head_sector < 0) {
+    // empty log, first append opens sector 0
+    if (this->isErased(0, 0)) this->erased_sector = 0;
+    return true;
+  }
+
+  // resume after the last programmed page, a torn page is left behind
+  this->write_offset = FLASH_LOG_SECTOR_SIZE;
+  while (this->write_offset > FLASH_LOG_PAGE_SIZE &&
+         this->isErased(this->head_sector,
+                        this->write_offset - FLASH_LOG_PAGE_SIZE)) {
+    this->write_offset -= FLASH_LOG_PAGE_SIZE;
+  }
+
+  uint32_t next = (this->head_sector + 1) % this->sector_count;
+  if (this->isErased(next, 0)) this->erased_sector = next;
+  return true;
+}
+
+/**
+ * @brief Appends a packet to the log, only programs flash when a page fills
+ *
+ * @param data Packet bytes
+ * @param len Length of the packet
+ * @return true if the packet was buffered or programmed
+ * @return false if flash failed
+ */
+bool FlashLog::append(const uint8_t* data, size_t len) {
+  if (this->sector_count < 2 || len == 0 || len > FLASH_LOG_MAX_PACKET) {
+    this->failed_count++;
+    return false;
+  }
+
+  if (this->head_sector < 0) {
+    uint32_t first = this->erased_sector >= 0 ? this->erased_sector : 0;
+    if (!this->openSector(first)) {
+      this->failed_count++;
+      return false;
+    }
+  }
+
+  size_t remaining = len;
+  while (remaining > 0) {
+    if (this->write_offset >= FLASH_LOG_SECTOR_SIZE &&
+        !this->openSector((this->head_sector + 1) % this->sector_count)) {
+      this->failed_count++;
+      return false;
+    }
+
+    size_t n = FLASH_LOG_PAGE_SIZE - this->page_fill;
+    if (n > remaining) n = remaining;
+    memcpy(this->page + this->page_fill, data, n);
+    this->page_fill += n;
+    data += n;
+    remaining -= n;
+
+    if (this->page_fill == FLASH_LOG_PAGE_SIZE && !this->programPage()) {
+      this->failed_count++;
+      return false;
+    }
+  }
+
+  this->appended_count++;
+  this->appended_bytes += len;
+  return true;
+}
+
+/**
+ * @brief Programs a partially filled page, the rest of the page is skipped
+ *
+ * @return true if nothing was pending or the program succeeded
+ * @return false otherwise
+ */
+bool FlashLog::flush() {
+  if (this->page_fill == 0) return true;
+  return this->programPage();
+}
+
+/**
+ * @brief Erases the sector after the head ahead of time, call when idle
+ *
+ * @return true if an erase was done
+ * @return false if there was nothing to do
+ */
+bool FlashLog::maintain() {
+  if (this->head_sector < 0) return false;
+  uint32_t next = (this->head_sector + 1) % this->sector_count;
+  if (this->erased_sector == (int32_t)next) return false;
+
+  if (this->isErased(next, 0)) {
+    this->erased_sector = next;
+    return false;
+  }
+
+  if (!this->eraseSector(next)) return false;
+  this->pre_erases++;
+  this->erased_sector = next;
+  return true;
+}
+
+uint32_t FlashLog::sectorAt(uint32_t sector_index) {
+  return (this->head_sector + 1 + sector_index) % this->sector_count;
+}
+
+/**
+ * @brief Gets where readable data ends in a sector
+ *
+ * @param sector_index Sectors from the oldest
+ * @return uint32_t Byte offset of the end, 0 if the sector holds no log data
+ */
+uint32_t FlashLog::readEnd(uint32_t sector_index) {
+  if (this->head_sector < 0 || sector_index >= this->sector_count) return 0;
+  uint32_t sector = this->sectorAt(sector_index);
+  uint32_t seq, erase_count;
+  if (!this->readHeader(sector, seq, erase_count)) return 0;
+  if ((int32_t)sector == this->head_sector) return this->write_offset;
+  return FLASH_LOG_SECTOR_SIZE;
+}
+
+/**
+ * @brief Reads log bytes, skipping sector headers and crossing into the next
+ * sector
+ *
+ * @param cursor Position to read from, advanced past the bytes read
+ * @param dst Buffer to read into
+ * @param len Number of bytes to read
+ * @return true if all the bytes were read
+ * @return false if the log ended first
+ */
+bool FlashLog::readStream(FlashLogCursor& cursor, uint8_t* dst, size_t len) {
+  while (len > 0) {
+    if (cursor.sector_index >= this->sector_count) return false;
+    uint32_t end = this->readEnd(cursor.sector_index);
+    if (cursor.offset < FLASH_LOG_HEADER_SIZE) {
+      cursor.offset = FLASH_LOG_HEADER_SIZE;
+    }
+    if (cursor.offset >= end) {
+      cursor.sector_index++;
+      cursor.offset = FLASH_LOG_HEADER_SIZE;
+      continue;
+    }
+
+    size_t n = end - cursor.offset;
+    if (n > len) n = len;
+    uint32_t sector = this->sectorAt(cursor.sector_index);
+    if (!this->flash->read(sector * FLASH_LOG_SECTOR_SIZE + cursor.offset, dst,
+                           n)) {
+      return false;
+    }
+    cursor.offset += n;
+    dst += n;
+    len -= n;
+  }
+  return true;
+}
+
+/**
+ * @brief Moves the cursor to the next packet sync word, stepping over sector
+ * headers so a sync split across two sectors is still found
+ *
+ * @param cursor Position to search from, left on the sync word
+ * @return true if a sync word was found
+ * @return false at the end of the log
+ */
+bool FlashLog::findSync(FlashLogCursor& cursor) {
+  // the last bytes seen and where each one is
+  uint8_t window[sizeof(PACKET_SYNC)];
+  FlashLogCursor window_at[sizeof(PACKET_SYNC)];
+  size_t seen = 0;
+
+  while (cursor.sector_index < this->sector_count) {
+    uint32_t end = this->readEnd(cursor.sector_index);
+    if (cursor.offset < FLASH_LOG_HEADER_SIZE) {
+      cursor.offset = FLASH_LOG_HEADER_SIZE;
+    }
+    if (cursor.offset >= end) {
+      cursor.sector_index++;
+      cursor.offset = FLASH_LOG_HEADER_SIZE;
+      continue;
+    }
+
+    uint8_t chunk[64];
+    uint32_t n = end - cursor.offset;
+    if (n > sizeof(chunk)) n = sizeof(chunk);
+    uint32_t sector = this->sectorAt(cursor.sector_index);
+    if (!this->flash->read(sector * FLASH_LOG_SECTOR_SIZE + cursor.offset,
+                           chunk, n)) {
+      return false;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+      memmove(window, window + 1, sizeof(window) - 1);
+      memmove(window_at, window_at + 1,
+              sizeof(window_at) - sizeof(window_at[0]));
+      window[sizeof(window) - 1] = chunk[i];
+      window_at[sizeof(window) - 1] = {cursor.sector_index, cursor.offset + i};
+      if (++seen >= sizeof(window) &&
+          memcmp(window, PACKET_SYNC, sizeof(PACKET_SYNC)) == 0) {
+        cursor = window_at[0];
+        return true;
+      }
+    }
+    cursor.offset += n;
+  }
+  return false;
+}
+
+/**
+ * @brief Reads the next intact packet, oldest first. Start with a zeroed
+ * cursor; padding, torn pages and packets failing their checksum are skipped
+ * by searching for the next sync word.
+ * Call flush() first to include buffered packets.
+ *
+ * @param cursor Read position, advanced past the packet
+ * @param dst Buffer to read the packet into
+ * @param max_len Size of the buffer
+ * @param packet_len Length of the packet read
+ * @return true if a packet was read
+ * @return false at the end of the log
+ */
+bool FlashLog::readPacket(FlashLogCursor& cursor, uint8_t* dst, size_t max_len,
+                          uint16_t& packet_len) {
+  while (cursor.sector_index < this->sector_count) {
+    uint32_t end = this->readEnd(cursor.sector_index);
+    if (cursor.offset < FLASH_LOG_HEADER_SIZE) {
+      cursor.offset = FLASH_LOG_HEADER_SIZE;
+    }
+    if (cursor.offset >= end) {
+      cursor.sector_index++;
+      cursor.offset = FLASH_LOG_HEADER_SIZE;
+      continue;
+    }
+
+    uint8_t head[PACKET_LEN_POS + sizeof(uint16_t)];
+    FlashLogCursor probe = cursor;
+    if (!this->readStream(probe, head, sizeof(head))) return false;
+
+    uint16_t len;
+    memcpy(&len, head + PACKET_LEN_POS, sizeof(len));
+    if (memcmp(head, PACKET_SYNC, sizeof(PACKET_SYNC)) == 0 &&
+        len >= PACKET_MIN_LEN && len <= max_len) {
+      probe = cursor;
+      if (this->readStream(probe, dst, len)) {
+        int8_t sum = 0;
+        for (uint16_t i = 0; i < len; i++) sum += (int8_t)dst[i];
+        if (sum == 0) {
+          cursor = probe;
+          packet_len = len;
+          return true;
+        }
+      }
+    }
+
+    // padding, torn or overwritten data, or a packet cut by a ring wrap,
+    // packets cross pages so resync on the next sync word after this byte
+    cursor.offset++;
+    if (!this->findSync(cursor)) return false;
+  }
+  return false;
+}
+
+uint32_t FlashLog::minEraseCount() const {
+  uint32_t result = UINT32_MAX;
+  for (uint32_t s = 0; s < this->sector_count; s++) {
+    if (this->erase_counts[s] < result) result = this->erase_counts[s];
+  }
+  return this->sector_count ? result : 0;
+}
+
+uint32_t FlashLog::maxEraseCount() const {
+  uint32_t result = 0;
+  for (uint32_t s = 0; s < this->sector_count; s++) {
+    if (this->erase_counts[s] > result) result = this->erase_counts[s];
+  }
+  return result;
+}
@@ -0,0 +1,113 @@
+#include "FlashStorage.h"
+
+/**
+ * @brief Construct a new FlashStorage object
+ *
+ */
+FlashStorage::FlashStorage() : Storage("Flash"), flash_log(backend) {
+  this->last_append = 0;
+}
+
+/**
+ * @brief Finds the end of the existing log so writing continues after it
+ *
+ * @return true if the flash region is usable
+ * @return false if no region is reserved
+ */
+bool FlashStorage::verify() {
+  if (this->backend.sectorCount() < 2) {
+    log_core("No flash region reserved, set board_build.filesystem_size");
+    return false;
+  }
+  if (!this->flash_log.recover()) return false;
+
+  this->logFlashStats();
+  return true;
+}
+
+/**
+ * @brief Store string data in flash, ending with newline
+ *
+ * @param data Data to store
+ */
+void FlashStorage::store(String data) {
+  data += "\n";
+  if (!this->flash_log.append((const uint8_t*)data.c_str(), data.length())) {
+    log_core("Flash write failed");
+  }
+  this->last_append = millis();
+}
+
+/**
+ * @brief Store packet data in flash
+ *
+ * @param packet Pointer to packet bytes
+ * @return true if the packet was appended
+ * @return false otherwise
+ */
+bool FlashStorage::storePacket(uint8_t* packet) {
+  // get length from the packet, after sync bytes (4) and sensor presense (4)
+  uint16_t packet_len;
+  memcpy(&packet_len, (packet + 8), sizeof(uint16_t));
+
+  this->last_append = millis();
+  if (!this->flash_log.append(packet, packet_len)) {
+    log_core("Flash write failed");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Flushes a stale partial page, otherwise erases the next sector ahead
+ * of time so storePacket() only has to program
+ *
+ */
+void FlashStorage::maintain() {
+  if (this->flash_log.pendingBytes() > 0 &&
+      millis() - this->last_append >= FLASH_STORAGE_FLUSH_MS) {
+    this->flash_log.flush();
+    return;
+  }
+  this->flash_log.maintain();
+}
+
+/**
+ * @brief Writes every intact packet in the log, oldest first, in the same
+ * format as the SD card RAWDATA files
+ *
+ * @param output Where to write the packets
+ */
+void FlashStorage::dump(Print& output) {
+  this->flash_log.flush();
+
+  uint8_t packet[QT_ENTRY_SIZE];
+  uint16_t packet_len;
+  FlashLogCursor cursor = {0, 0};
+  uint32_t count = 0;
+  while (this->flash_log.readPacket(cursor, packet, sizeof(packet),
+                                    packet_len)) {
+    output.write(packet, packet_len);
+    count++;
+  }
+  log_core_printf("Dumped %lu packets from flash\n", (unsigned long)count);
+}
+
+/**
+ * @brief Logs the flash log counters
+ *
+ */
+void FlashStorage::logFlashStats() {
+  log_core_printf(
+      "Flash: seq %lu, %lu packets (%lu B), %lu failed, erases %lu pre / %lu "
+      "inline, %lu overwritten, wear %lu-%lu\n",
+      (unsigned long)this->flash_log.headSequence(),
+      (unsigned long)this->flash_log.appendedCount(),
+      (unsigned long)this->flash_log.appendedBytes(),
+      (unsigned long)this->flash_log.failedCount(),
+      (unsigned long)this->flash_log.preErases(),
+      (unsigned long)this->flash_log.inlineErases(),
+      (unsigned long)this->flash_log.overwrittenSectors(),
+      (unsigned long)this->flash_log.minEraseCount(),
+      (unsigned long)this->flash_log.maxEraseCount());
+}
@@ -26,11 +26,11 @@ void GeigerSensor::readDataPacket(uint8_t*& packet) {
   packet += sizeof(float);
 }
 
-String GeigerSensor::decodeToCSV(uint8_t*& packet) {
+void GeigerSensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   float cps, dose;
   memcpy(&cps, packet, sizeof(float));
   packet += sizeof(float);
   memcpy(&dose, packet, sizeof(float));
   packet += sizeof(float);
-  return String(cps) + "," + String(dose) + ",";
+  csv.addFloat(cps).addFloat(dose);
 }
\ No newline at end of file
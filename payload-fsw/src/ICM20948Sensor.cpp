@@ -110,27 +110,23 @@ void ICM20948Sensor::readDataPacket(uint8_t*& packet) {
 }
 
 /**
- * @brief Decodes the ICM sensor data from the packet buffer into a CSV string.
+ * @brief Decodes the ICM sensor data from the packet buffer into CSV cells.
  * Reads the data in the same order as it was appended and increments the packet
  * pointer.
  *
  * @param packet Pointer to the packet byte array which is incremented after
  * extracting each value.
- * @return String A CSV string of the sensor data.
+ * @param csv Row to append the sensor data to.
  */
-String ICM20948Sensor::decodeToCSV(uint8_t*& packet) {
-  // Read values from the packet buffer by casting the pointer to a float
-
+void ICM20948Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
+  // Read values from the packet buffer, copying since they aren't aligned
   const size_t vals_len = 10;
-  float vals[vals_len];
-  String csv_row;
 
   for (size_t i = 0; i < vals_len; i++) {
     float temp;
     memcpy(&temp, packet, sizeof(float));
     packet += sizeof(float);
 
-    csv_row += String(temp) + ",";
+    csv.addFloat(temp);
   }
-  return csv_row;
 }
\ No newline at end of file
@@ -57,12 +57,12 @@ void OzoneSensor::readDataPacket(uint8_t*& packet) {
  * @brief Decodes ozone concentration data from a packet to CSV
  *
  * @param packet The packet to decode from
- * @return String CSV stub of O3 PPB
+ * @param csv Row to append O3 PPB to
  */
-String OzoneSensor::decodeToCSV(uint8_t*& packet) {
+void OzoneSensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   int16_t ozone_val = 0;
   memcpy(&ozone_val, packet, sizeof(int16_t));
   packet += sizeof(int16_t);
 
-  return String(ozone_val) + ",";
+  csv.addInt(ozone_val);
 }
\ No newline at end of file
@@ -53,15 +53,15 @@ void PCF8523Sensor::readDataPacket(uint8_t*& packet) {
 }
 
 /**
- * @brief Decode the packet data and returns it in CSV format
+ * @brief Decode the packet data and append it in CSV format
  *
- * Decodes the packet data from the PCF8523 sesor and returns it in CSV format.
+ * Decodes the packet data from the PCF8523 sesor and appends it in CSV format.
  * The data includes date and time.
  *
  * @param packet - Packet to decode
- * @return String - A String containing the sensor readings
+ * @param csv - Row to append the sensor readings to
  */
-String PCF8523Sensor::decodeToCSV(uint8_t*& packet) {
+void PCF8523Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   uint16_t year;
   memcpy(&year, packet, sizeof(uint16_t));
   packet += sizeof(uint16_t);
@@ -72,6 +72,10 @@ String PCF8523Sensor::decodeToCSV(uint8_t*& packet) {
     packet += sizeof(uint8_t);
   }
 
-  return String(year) + "/" + String(data[0]) + "/" + String(data[1]) + " " +
-         String(data[2]) + ":" + String(data[3]) + ":" + String(data[4]) + ",";
+  csv.appendUInt(year).appendChar('/');
+  csv.appendUInt(data[0]).appendChar('/');
+  csv.appendUInt(data[1]).appendChar(' ');
+  csv.appendUInt(data[2]).appendChar(':');
+  csv.appendUInt(data[3]).appendChar(':');
+  csv.addUInt(data[4]);
 }
\ No newline at end of file
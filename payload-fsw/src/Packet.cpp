@@ -0,0 +1,160 @@
+#include "Packet.h"
+
+/**
+ * @brief Reads sensor data into a packet byte array
+ *
+ * @param sensors Array of sensors to read from, in bitmask order
+ * @param sensors_len Number of sensors in the array
+ * @param packet Pointer to the packet array
+ * @return uint16_t Length of the packet including the checksum
+ */
+uint16_t readSensorDataPacket(Sensor** sensors, int sensors_len,
+                              uint8_t* packet) {
+  // set sync bytes
+  uint8_t* temp_packet = packet;
+  std::copy(SYNC_BYTES, SYNC_BYTES + sizeof(SYNC_BYTES), temp_packet);
+  temp_packet += sizeof(SYNC_BYTES);
+
+  uint32_t sensor_id = 0;
+  uint16_t packet_len = 0;
+  temp_packet += sizeof(sensor_id) + sizeof(packet_len);
+
+  // build packet
+  // millis()
+  uint32_t now = millis();
+  std::copy((uint8_t*)(&now), (uint8_t*)(&now) + sizeof(now), temp_packet);
+  temp_packet += sizeof(now);
+  sensor_id = (sensor_id << 1) | 1;
+  // rest of the packet
+  for (int i = 0; i < sensors_len; i++) {
+    if (sensors[i]->attemptConnection()) {
+      sensors[i]->getDataPacket(sensor_id, temp_packet);
+    } else {
+      sensor_id <<= 1;
+    }
+  }
+
+  // calc data len
+  packet_len = (temp_packet - packet) + 1;  // + 1 for checksum
+#if PACKET_DEBUG_LOG
+  log_core_printf("Packet Len: %d\n", packet_len);
+#endif
+
+  // write sensor_id
+  temp_packet = packet + sizeof(SYNC_BYTES);
+  std::copy((uint8_t*)(&sensor_id), (uint8_t*)(&sensor_id) + sizeof(sensor_id),
+            temp_packet);
+
+  // write data len
+  temp_packet += sizeof(sensor_id);
+  std::copy((uint8_t*)(&packet_len),
+            (uint8_t*)(&packet_len) + sizeof(packet_len), temp_packet);
+
+  // calculate checksum with sum complement parity
+  *(packet + packet_len - 1) = -packetChecksum(packet, packet_len);
+
+  return packet_len;
+}
+
+/**
+ * @brief Decodes the packet to a CSV row
+ *
+ * @param sensors Array of sensors the packet was built from
+ * @param sensors_len Number of sensors in the array
+ * @param packet Pointer to the packet array
+ * @return String The resulting CSV row
+ */
+String decodePacket(Sensor** sensors, int sensors_len, uint8_t* packet) {
+  char row[CSV_ROW_MAX_SIZE];
+  CsvWriter csv(row, sizeof(row));
+  decodePacket(sensors, sensors_len, packet, csv);
+  return String(row);
+}
+
+/**
+ * @brief Decodes the packet to a CSV row written straight into a fixed buffer
+ *
+ * @param sensors Array of sensors the packet was built from
+ * @param sensors_len Number of sensors in the array
+ * @param packet Pointer to the packet array
+ * @param csv Row to write the decoded cells to
+ * @return size_t Length of the resulting CSV row
+ */
+size_t decodePacket(Sensor** sensors, int sensors_len, uint8_t* packet,
+                    CsvWriter& csv) {
+  uint8_t* temp_packet = packet + PACKET_SENSOR_ID_OFFSET;
+
+  uint32_t sensor_id;
+  memcpy(&sensor_id, temp_packet, sizeof(sensor_id));
+  temp_packet += sizeof(sensor_id);
+  uint16_t packet_len;
+  memcpy(&packet_len, temp_packet, sizeof(packet_len));
+  temp_packet += sizeof(packet_len);
+
+  // start with sensor_id in a cell in Hex
+  csv.addHex(sensor_id);
+
+  uint32_t sensor_id_temp = sensor_id;
+  uint8_t id_offset = 0;
+  for (int i = 0; i < 32; i++) {
+    if (sensor_id_temp & (1 << i)) {
+      id_offset = i;
+    }
+  }
+
+  // millis decode
+  // the words aren't aligned because of the uint16_t len
+  // so casting will crash the pico
+  uint32_t r_now;
+  memcpy(&r_now, temp_packet, sizeof(uint32_t));
+
+  temp_packet += sizeof(r_now);
+  csv.addUInt(r_now);
+
+  int curr_offset = id_offset - 1;
+  while (curr_offset >= 0 && id_offset - curr_offset - 1 < sensors_len) {
+    if (sensor_id & (1 << curr_offset)) {
+      sensors[id_offset - curr_offset - 1]->decodeToCSV(temp_packet, csv);
+    } else if (sensors[id_offset - curr_offset - 1]->getVerified()) {
+      csv.appendRaw(sensors[id_offset - curr_offset - 1]->readEmpty());
+    }
+    curr_offset--;
+  }
+
+  // check parity
+  if (!packetChecksumValid(packet, packet_len)) {
+    log_core("Packet checksum mismatch");
+  }
+
+  return csv.size();
+}
+
+/**
+ * @brief Sums every byte of the packet before the checksum byte
+ *
+ * @param packet Pointer to the packet bytes
+ * @param packet_len Length of the packet including the checksum
+ * @return int8_t The byte sum, the packet stores its negation
+ */
+int8_t packetChecksum(const uint8_t* packet, uint16_t packet_len) {
+  int8_t checksum = 0;
+  for (size_t i = 0; i + 1 < packet_len; i++) {
+    checksum += packet[i];
+  }
+  return checksum;
+}
+
+/**
+ * @brief Checks the sum complement parity of a packet
+ *
+ * @param packet Pointer to the packet bytes
+ * @param packet_len Length of the packet including the checksum
+ * @return true if every byte including the checksum sums to 0
+ * @return false otherwise
+ */
+bool packetChecksumValid(const uint8_t* packet, uint16_t packet_len) {
+  if (packet_len == 0) return false;
+  int8_t sum = packetChecksum(packet, packet_len);
+  sum += (int8_t)packet[packet_len - 1];
+  return sum == 0;
+}
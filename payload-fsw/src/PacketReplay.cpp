@@ -0,0 +1,150 @@
+#include "PacketReplay.h"
+
+/**
+ * @brief Construct a new PacketReplay object
+ *
+ * @param time_scale Playback speed relative to the recording, 0 for max speed
+ */
+PacketReplay::PacketReplay(float time_scale) {
+  this->time_scale = time_scale;
+  this->pending_len = 0;
+  this->first_packet_millis = 0;
+  this->replay_start_millis = 0;
+  this->started = false;
+  this->packets_replayed = 0;
+  this->packets_rejected = 0;
+  this->bytes_replayed = 0;
+}
+
+/**
+ * @brief Opens the recorded file, the SD card must already be started
+ *
+ * @param file_name Name of the recorded packet file
+ * @return true if the file was opened
+ * @return false otherwise
+ */
+bool PacketReplay::begin(const String& file_name) {
+  this->source = SD.open(file_name, FILE_READ);
+  if (!this->source) {
+    log_core("Replay file " + file_name + " not found");
+    return false;
+  }
+
+  log_core("Replaying " + file_name + " (" + String(this->source.size()) +
+           " bytes)");
+  this->pending_len = 0;
+  this->started = false;
+  return true;
+}
+
+/**
+ * @brief Reads the next valid packet from the file, resyncing on the sync
+ * bytes after any corrupt or truncated packet. The search restarts at the
+ * byte after a rejected sync word, so a corrupt length can't swallow the
+ * packets after it
+ *
+ * @param packet Buffer of at least QT_ENTRY_SIZE bytes
+ * @return uint16_t Length of the packet, 0 at the end of the file
+ */
+uint16_t PacketReplay::readPacket(uint8_t* packet) {
+  size_t matched = 0;
+  while (this->source.available()) {
+    int c = this->source.read();
+    if (c < 0) break;
+
+    // find the sync bytes
+    if (c != SYNC_BYTES[matched]) {
+      matched = (c == SYNC_BYTES[0]) ? 1 : 0;
+      continue;
+    }
+    if (++matched < sizeof(SYNC_BYTES)) continue;
+    matched = 0;
+    uint32_t resync = this->source.position() - sizeof(SYNC_BYTES) + 1;
+
+    // rest of the header, then sensor data and checksum
+    memcpy(packet, SYNC_BYTES, sizeof(SYNC_BYTES));
+    size_t header_rest = PACKET_HEADER_SIZE - sizeof(SYNC_BYTES);
+    uint16_t packet_len = 0;
+    if (this->source.read(packet + sizeof(SYNC_BYTES), header_rest) ==
+        header_rest) {
+      packet_len = packetLength(packet);
+    }
+    if (packet_len > PACKET_HEADER_SIZE && packet_len <= QT_ENTRY_SIZE) {
+      size_t body_len = packet_len - PACKET_HEADER_SIZE;
+      if (this->source.read(packet + PACKET_HEADER_SIZE, body_len) ==
+              body_len &&
+          packetChecksumValid(packet, packet_len)) {
+        return packet_len;
+      }
+    }
+
+    // a corrupt or truncated packet, or sync bytes inside another packet
+    this->packets_rejected++;
+    this->source.seek(resync);
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Gets the next packet once it is due according to the time scale
+ *
+ * @param packet Buffer of at least QT_ENTRY_SIZE bytes
+ * @return uint16_t Length of the packet, 0 if no packet is due yet or the
+ * replay is done
+ */
+uint16_t PacketReplay::nextPacket(uint8_t* packet) {
+  if (!this->source) return 0;
+
+  if (this->pending_len == 0) {
+    this->pending_len = this->readPacket(this->pending);
+    if (this->pending_len == 0) return 0;
+  }
+
+  uint32_t packet_millis = packetMillis(this->pending);
+  if (!this->started) {
+    this->started = true;
+    this->first_packet_millis = packet_millis;
+    this->replay_start_millis = millis();
+  }
+
+  // hold the packet until it is due
+  if (this->time_scale > 0) {
+    uint32_t recorded_offset = packet_millis - this->first_packet_millis;
+    uint32_t due = this->replay_start_millis +
+                   (uint32_t)(recorded_offset / this->time_scale);
+    if ((int32_t)(millis() - due) < 0) return 0;
+  }
+
+  uint16_t packet_len = this->pending_len;
+  memcpy(packet, this->pending, packet_len);
+  this->pending_len = 0;
+
+  this->packets_replayed++;
+  this->bytes_replayed += packet_len;
+  return packet_len;
+}
+
+/**
+ * @brief Checks if every packet in the file has been replayed
+ *
+ * @return true if the file is exhausted
+ * @return false otherwise
+ */
+bool PacketReplay::done() {
+  return !this->source ||
+         (this->pending_len == 0 && this->source.available() == 0);
+}
+
+/**
+ * @brief Logs the packet count and throughput of the replay so far
+ *
+ */
+void PacketReplay::logStats() {
+  uint32_t elapsed = millis() - this->replay_start_millis;
+  log_core_printf(
+      "Replay: %lu packets (%lu rejected), %lu bytes in %lu ms, %lu B/s\n",
+      this->packets_replayed, this->packets_rejected, this->bytes_replayed,
+      elapsed,
+      elapsed ? (uint32_t)(this->bytes_replayed * 1000ULL / elapsed) : 0);
+}
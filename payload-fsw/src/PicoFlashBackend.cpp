@@ -0,0 +1,47 @@
+#include "PicoFlashBackend.h"
+
+#include "hardware/flash.h"
+
+// filesystem region from the arduino-pico linker script
+extern uint8_t _FS_start;
+extern uint8_t _FS_end;
+
+/**
+ * @brief Construct a new PicoFlashBackend object over the filesystem region
+ *
+ */
+PicoFlashBackend::PicoFlashBackend() {
+  this->region_offset = (uintptr_t)&_FS_start - XIP_BASE;
+  this->sector_count = (&_FS_end - &_FS_start) / FLASH_LOG_SECTOR_SIZE;
+}
+
+bool PicoFlashBackend::read(uint32_t offset, uint8_t* dst, size_t len) {
+  if (offset + len > this->sector_count * FLASH_LOG_SECTOR_SIZE) return false;
+  // flash is memory mapped
+  uintptr_t address = XIP_BASE + this->region_offset + offset;
+  memcpy(dst, (const uint8_t*)address, len);
+  return true;
+}
+
+bool PicoFlashBackend::eraseSector(uint32_t sector) {
+  if (sector >= this->sector_count) return false;
+  noInterrupts();
+  rp2040.idleOtherCore();
+  flash_range_erase(this->region_offset + sector * FLASH_LOG_SECTOR_SIZE,
+                    FLASH_LOG_SECTOR_SIZE);
+  rp2040.resumeOtherCore();
+  interrupts();
+  return true;
+}
+
+bool PicoFlashBackend::programPage(uint32_t offset, const uint8_t* src) {
+  if (offset % FLASH_LOG_PAGE_SIZE != 0 ||
+      offset + FLASH_LOG_PAGE_SIZE > this->sector_count * FLASH_LOG_SECTOR_SIZE)
+    return false;
+  noInterrupts();
+  rp2040.idleOtherCore();
+  flash_range_program(this->region_offset + offset, src, FLASH_LOG_PAGE_SIZE);
+  rp2040.resumeOtherCore();
+  interrupts();
+  return true;
+}
@@ -7,49 +7,140 @@
 SDStorage::SDStorage() : Storage("SD Card") {}
 
 /**
- * @brief Verify SD card connection and create a new, unique file
+ * @brief Verify SD card connection and create a new, unique file, or reopen
+ * the file from this boot after a transient failure
  *
  * @return true if SD card is connected and file is successfully created
  * @return false otherwise
  */
 bool SDStorage::verify() {
+  VerifyStatus status;
+  do {
+    status = this->verifyStep();
+  } while (status == VerifyStatus::VERIFY_PENDING);
+  return status == VerifyStatus::VERIFY_DONE;
+}
+
+/**
+ * @brief Runs the next step of verify(), so a reverification only holds core
+ * 1 for one SD call per loop
+ *
+ * @return VerifyStatus VERIFY_PENDING until the file has been opened
+ */
+VerifyStatus SDStorage::verifyStep() {
+  switch (this->verify_state) {
+    case SDVerifyState::BEGIN:
 // initialize SD card w/ instance
 // setup SPI1
 #if SD_SPI1
-  if (!SD.begin(SD_CS_PIN, this->sd_spi_1)) {
-    ErrorDisplay::instance().addCode(Error::SD_CARD_FAIL);
-    return false;
-  }
+      if (!SD.begin(SD_CS_PIN, this->sd_spi_1)) {
 #else
-  if (!SD.begin(SD_CS_PIN)) {
-    ErrorDisplay::instance().addCode(Error::SD_CARD_FAIL);
-    return false;
-  }
+      if (!SD.begin(SD_CS_PIN)) {
 #endif
+        ErrorDisplay::instance().addCode(Error::SD_CARD_FAIL);
+        return VerifyStatus::VERIFY_FAILED;
+      }
+      this->verify_state = SDVerifyState::PICK_FILE;
+      return VerifyStatus::VERIFY_PENDING;
 
-// find unused file name
-#if STORING_PACKETS
-  // for bin (eventually just have 1 of these)
-  int num = 0;
-  while (SD.exists("RAWDATA" + String(num) + ".BIN")) num++;
-  if (num != 0) ErrorDisplay::instance().addCode(Error::POWER_CYCLED);
-  this->file_name = "RAWDATA" + String(num) + ".BIN";
-  log_core("Created file: " + this->file_name);
-#else
-  int num = 0;
-  while (SD.exists("DATA" + String(num) + ".CSV")) num++;
-  if (num != 0) ErrorDisplay::instance().addCode(Error::POWER_CYCLED);
-  this->file_name = "DATA" + String(num) + ".CSV";
-#endif
+    case SDVerifyState::PICK_FILE:
+      // a transient failure keeps writing to the file from this boot
+      if (this->file_name.length() > 0) {
+        log_core("Reusing file: " + this->file_name);
+      } else {
+        int num = this->nextFileNumber();
+        if (num != 0) ErrorDisplay::instance().addCode(Error::POWER_CYCLED);
+        this->file_name = SD_FILE_PREFIX + String(num) + SD_FILE_SUFFIX;
+        log_core("Created file: " + this->file_name);
+        this->saveBootCount(num + 1);
+      }
+      log_core("SD Filename: " + this->file_name);
+      this->verify_state = SDVerifyState::OPEN_FILE;
+      return VerifyStatus::VERIFY_PENDING;
+
+    case SDVerifyState::OPEN_FILE: {
+      this->verify_state = SDVerifyState::BEGIN;
+      // create file
+      File f = SD.open(this->file_name, FILE_WRITE);
+      if (!f) return VerifyStatus::VERIFY_FAILED;
+      f.close();
+      return VerifyStatus::VERIFY_DONE;  // recovery system will handle this now
+    }
+  }
+  return VerifyStatus::VERIFY_FAILED;
+}
+
+/**
+ * @brief Gets the number of the next log file from the boot count file,
+ * falling back to a single directory scan if it is missing or stale
+ *
+ * @return int Unused file number
+ */
+int SDStorage::nextFileNumber() {
+  File count_file = SD.open(SD_BOOT_COUNT_FILE, FILE_READ);
+  if (count_file) {
+    char text[12] = {0};
+    count_file.read((uint8_t*)text, sizeof(text) - 1);
+    count_file.close();
 
-  log_core("SD Filename: " + this->file_name);
+    char* end;
+    long num = strtol(text, &end, 10);
+    // a crash between creating the file and saving the count leaves it stale
+    if (end != text && num >= 0 &&
+        !SD.exists(SD_FILE_PREFIX + String(num) + SD_FILE_SUFFIX)) {
+      return num;
+    }
+  }
+
+  log_core("Boot count missing or stale, scanning files");
+  return this->scanFileNumber();
+}
+
+/**
+ * @brief Finds the number after the highest numbered log file in one pass
+ * over the root directory
+ *
+ * @return int Unused file number
+ */
+int SDStorage::scanFileNumber() {
+  const size_t prefix_len = strlen(SD_FILE_PREFIX);
+  int next_num = 0;
 
-  // create file
-  File f = SD.open(this->file_name, FILE_WRITE);
-  if (!f) return false;  // check to see if the open operation worked
-  f.close();
+  File root = SD.open("/");
+  if (!root) return 0;
+  File entry = root.openNextFile();
+  while (entry) {
+    const char* name = entry.name();
+    if (!entry.isDirectory() &&
+        strncasecmp(name, SD_FILE_PREFIX, prefix_len) == 0 &&
+        isdigit(name[prefix_len])) {
+      char* end;
+      long num = strtol(name + prefix_len, &end, 10);
+      if (strcasecmp(end, SD_FILE_SUFFIX) == 0 && num >= next_num) {
+        next_num = num + 1;
+      }
+    }
+    entry.close();
+    entry = root.openNextFile();
+  }
+  root.close();
+  return next_num;
+}
 
-  return true;  // recovery system will handle this now
+/**
+ * @brief Saves the number of the next log file for the next boot
+ *
+ * @param next_num Number the next boot should use
+ */
+void SDStorage::saveBootCount(int next_num) {
+  SD.remove(SD_BOOT_COUNT_FILE);
+  File count_file = SD.open(SD_BOOT_COUNT_FILE, FILE_WRITE);
+  if (!count_file) {
+    log_core("Failed to save boot count");
+    return;
+  }
+  count_file.println(next_num);
+  count_file.close();
 }
 
 /**
@@ -80,8 +171,10 @@ void SDStorage::store(String data) {
  * @brief Store data on the SD card
  *
  * @param packet Pointer to packet bytes
+ * @return true if the whole packet was written
+ * @return false otherwise, the card is flagged for reverification
  */
-void SDStorage::storePacket(uint8_t* packet) {
+bool SDStorage::storePacket(uint8_t* packet) {
   File output = SD.open(this->file_name, FILE_WRITE);
   if (!output) {
     log_core("SD card write failed");
@@ -90,14 +183,20 @@ void SDStorage::storePacket(uint8_t* packet) {
     SD.end();  // close instance
 
     this->verified = false;  // flag the device for reverification
-    return;
+    return false;
   }
 
   // get length from the packet, after sync bytes (4) and sensor presense (4)
   uint16_t packet_len;
   memcpy(&packet_len, (packet + 8), sizeof(uint16_t));
 
-  if(packet_len < QT_ENTRY_SIZE) output.write(packet, packet_len);
-
+  bool written = output.write(packet, packet_len) == packet_len;
   output.close();
+  if (!written) {
+    log_core("SD card write failed");
+    ErrorDisplay::instance().addCode(Error::SD_CARD_FAIL);
+    SD.end();
+    this->verified = false;
+  }
+  return written;
 }
\ No newline at end of file
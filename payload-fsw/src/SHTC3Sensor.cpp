@@ -68,9 +68,9 @@ void SHTC3Sensor::readDataPacket(uint8_t*& packet) {
  * @brief Decodes data from the packet
  *
  * @param packet Pointer to decode at
- * @return String CSV stub Temperature, Humidity
+ * @param csv Row to append Temperature, Humidity to
  */
-String SHTC3Sensor::decodeToCSV(uint8_t*& packet) {
+void SHTC3Sensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   float temperature = 0;
   float humidity = 0;
 
@@ -80,7 +80,7 @@ String SHTC3Sensor::decodeToCSV(uint8_t*& packet) {
   memcpy(&humidity, packet, sizeof(humidity));
   packet += sizeof(humidity);
 
-  return String(temperature) + "," + String(humidity) + ",";
+  csv.addFloat(temperature).addFloat(humidity);
 }
 
 /**
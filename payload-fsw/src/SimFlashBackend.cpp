@@ -0,0 +1,106 @@
+#include "SimFlashBackend.h"
+
+#include <string.h>
+
+/**
+ * @brief Construct a new SimFlashBackend object, the region starts erased
+ *
+ * @param sector_count Number of sectors to simulate
+ * @param erase_us Simulated time of one sector erase
+ * @param program_us Simulated time of one page program
+ */
+SimFlashBackend::SimFlashBackend(uint32_t sector_count, uint32_t erase_us,
+                                 uint32_t program_us) {
+  this->sector_count = sector_count;
+  this->memory = new uint8_t[sector_count * FLASH_LOG_SECTOR_SIZE];
+  memset(this->memory, 0xFF, sector_count * FLASH_LOG_SECTOR_SIZE);
+  this->erase_counts = new uint32_t[sector_count]();
+
+  this->erase_us = erase_us;
+  this->program_us = program_us;
+  this->elapsed_us = 0;
+  this->longest_op_us = 0;
+
+  this->ops_until_cut = -1;
+  this->powered = true;
+}
+
+SimFlashBackend::~SimFlashBackend() {
+  delete[] this->memory;
+  delete[] this->erase_counts;
+}
+
+/**
+ * @brief Counts down to the power cut
+ *
+ * @return true if the operation should complete
+ * @return false if power is cut during it
+ */
+bool SimFlashBackend::takeOp() {
+  if (this->ops_until_cut < 0) return true;
+  if (this->ops_until_cut == 0) {
+    this->powered = false;
+    this->ops_until_cut = -1;
+    return false;
+  }
+  this->ops_until_cut--;
+  return true;
+}
+
+bool SimFlashBackend::read(uint32_t offset, uint8_t* dst, size_t len) {
+  if (!this->powered) return false;
+  if (offset + len > this->sector_count * FLASH_LOG_SECTOR_SIZE) return false;
+  memcpy(dst, this->memory + offset, len);
+  return true;
+}
+
+bool SimFlashBackend::eraseSector(uint32_t sector) {
+  if (!this->powered || sector >= this->sector_count) return false;
+  uint8_t* start = this->memory + sector * FLASH_LOG_SECTOR_SIZE;
+
+  if (!this->takeOp()) {
+    // torn erase, only the first half made it back to 0xFF
+    memset(start, 0xFF, FLASH_LOG_SECTOR_SIZE / 2);
+    return false;
+  }
+
+  memset(start, 0xFF, FLASH_LOG_SECTOR_SIZE);
+  this->erase_counts[sector]++;
+  this->elapsed_us += this->erase_us;
+  if (this->erase_us > this->longest_op_us) {
+    this->longest_op_us = this->erase_us;
+  }
+  return true;
+}
+
+bool SimFlashBackend::programPage(uint32_t offset, const uint8_t* src) {
+  if (!this->powered || offset % FLASH_LOG_PAGE_SIZE != 0) return false;
+  if (offset + FLASH_LOG_PAGE_SIZE > this->sector_count * FLASH_LOG_SECTOR_SIZE)
+    return false;
+
+  // programming can only clear bits
+  size_t len = FLASH_LOG_PAGE_SIZE;
+  bool completed = this->takeOp();
+  if (!completed) len /= 2;  // torn program
+  for (size_t i = 0; i < len; i++) this->memory[offset + i] &= src[i];
+  if (!completed) return false;
+
+  this->elapsed_us += this->program_us;
+  if (this->program_us > this->longest_op_us) {
+    this->longest_op_us = this->program_us;
+  }
+  return true;
+}
+
+/**
+ * @brief Cuts power partway through a later operation
+ *
+ * @param ops Number of erase or program operations that complete first
+ */
+void SimFlashBackend::cutPowerAfter(int32_t ops) { this->ops_until_cut = ops; }
+
+/**
+ * @brief Restores power after a cut, as on a reboot
+ *
+ */
+void SimFlashBackend::powerOn() { this->powered = true; }
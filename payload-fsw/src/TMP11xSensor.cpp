@@ -56,18 +56,18 @@ void TMP11xSensor::readDataPacket(uint8_t*& packet) {
 }
 
 /**
- * @brief Decodes sensor data from the packet into a CSV string.
+ * @brief Decodes sensor data from the packet into CSV cells.
  *
  * @param packet  Pointer to packet byte array that will be decoded.
- * @return String Decoded sensor data in CSV format.
+ * @param csv Row to append the decoded sensor data to.
  */
-String TMP11xSensor::decodeToCSV(uint8_t*& packet) {
+void TMP11xSensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   float tempC;
   memcpy(&tempC, packet, sizeof(float));
 
   packet += sizeof(float);
 
-  return String(tempC) + ",";
+  csv.addFloat(tempC);
 }
 
 /**
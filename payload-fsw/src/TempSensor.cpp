@@ -45,7 +45,7 @@ void TempSensor::readDataPacket(uint8_t*& packet) {
   packet += sizeof(temp);
 }
 
-String TempSensor::decodeToCSV(uint8_t*& packet) {
+void TempSensor::decodeToCSV(uint8_t*& packet, CsvWriter& csv) {
   // cast the packet pointer to pointer of the data type to read (float) then
   // dereference it
   float temp;  // = *((float*)packet);
@@ -54,6 +54,6 @@ String TempSensor::decodeToCSV(uint8_t*& packet) {
   // increment packet by the size of the read data type (float)
   packet += sizeof(float);
 
-  // return in csv snippet format
-  return String(temp) + ",";
+  // append in csv snippet format
+  csv.addFloat(temp);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 // error code framework
 #include "ErrorDisplay.h"
 #include "Logger.h"
+#include "Packet.h"
 #include "PayloadConfig.h"
 
 // parent classes
@@ -31,8 +32,6 @@ int verifySensors();
 void handleCommand();
 int verifySensorRecovery();
 String readSensorData();
-uint16_t readSensorDataPacket(uint8_t* packet);
-String decodePacket(uint8_t* packet);
 
 void handleDataInterface();
 
@@ -63,7 +62,8 @@ Sensor* sensors[] = {
     &bmp_sensor_out, &tmp_sensor_out, &shtc3_sensor_out, &ozone_sensor_out,
 };
 
-const int sensors_len = sizeof(sensors) / sizeof(sensors[0]);
+// extern so core 1 can decode replayed packets
+extern const int sensors_len = sizeof(sensors) / sizeof(sensors[0]);
 
 String header_condensed = "";
 
@@ -156,14 +156,19 @@ void loop() {
   uint8_t packet[QT_ENTRY_SIZE];
   // for (int i = 0; i < QT_ENTRY_SIZE; i++) packet[i] = 0; // useful for
   // debugging
-  uint16_t packet_len = readSensorDataPacket(packet);
+  uint16_t packet_len = readSensorDataPacket(sensors, sensors_len, packet);
 
-  // String data_str = decodePacket(packet);
+  // String data_str = decodePacket(sensors, sensors_len, packet);
   // log_core("Data: " + data_str);
 
   // print csv row
-  // log_data(csv_row);
+#if SERIAL_LIVE_CSV
+  static char csv_row[CSV_ROW_MAX_SIZE];
+  CsvWriter csv(csv_row, sizeof(csv_row));
+  log_data_csv(csv_row, decodePacket(sensors, sensors_len, packet, csv));
+#else
   log_data_raw(packet, packet_len);
+#endif
 
   // send data to core1
   // queue_add_blocking(&qt, packet);
@@ -200,120 +205,6 @@ int verifySensorRecovery() {
   return count;
 }
 
-/**
- * @brief Reads sensor data into a packet byte array
- *
- * @param packet Pointer to the packet array
- */
-uint16_t readSensorDataPacket(uint8_t* packet) {
-  // set sync bytes
-  uint8_t* temp_packet = packet;
-  std::copy(SYNC_BYTES, SYNC_BYTES + sizeof(SYNC_BYTES), temp_packet);
-  temp_packet += sizeof(SYNC_BYTES);
-
-  uint32_t sensor_id = 0;
-  uint16_t packet_len = 0;
-  temp_packet += sizeof(sensor_id) + sizeof(packet_len);
-
-  // build packet
-  // millis()
-  uint32_t now = millis();
-  std::copy((uint8_t*)(&now), (uint8_t*)(&now) + sizeof(now), temp_packet);
-  temp_packet += sizeof(now);
-  sensor_id = (sensor_id << 1) | 1;
-  // rest of the packet
-  for (int i = 0; i < sensors_len; i++) {
-    if (sensors[i]->attemptConnection()) {
-      sensors[i]->getDataPacket(sensor_id, temp_packet);
-    } else {
-      sensor_id <<= 1;
-    }
-  }
-
-  // calc data len
-  packet_len = (temp_packet - packet) + 1;  // + 1 for checksum
-  log_core_printf("Packet Len: %d\n", packet_len);
-
-  // write sensor_id
-  temp_packet = packet + sizeof(SYNC_BYTES);
-  std::copy((uint8_t*)(&sensor_id), (uint8_t*)(&sensor_id) + sizeof(sensor_id),
-            temp_packet);
-
-  // write data len
-  temp_packet += sizeof(sensor_id);
-  std::copy((uint8_t*)(&packet_len),
-            (uint8_t*)(&packet_len) + sizeof(packet_len), temp_packet);
-
-  // calculate checksum with sum complement parity
-  int8_t checksum = 0;
-  for (size_t i = 0; i < packet_len - 1; i++) {
-    checksum += packet[i];
-  }
-  *(packet + packet_len - 1) = -checksum;
-
-  return packet_len;
-}
-
-/**
- * @brief Decodes the packet to a CSV row
- *
- * @param packet Pointer to the packet array
- * @return String The resulting CSV row
- */
-String decodePacket(uint8_t* packet) {
-  uint8_t* temp_packet = packet;
-
-  uint32_t sync_bytes = *((uint32_t*)temp_packet);
-  temp_packet += sizeof(sync_bytes);
-  uint32_t sensor_id = *((uint32_t*)temp_packet);
-  temp_packet += sizeof(sensor_id);
-  uint16_t packet_len = *((uint16_t*)temp_packet);
-  temp_packet += sizeof(packet_len);
-
-  // start with sensor_id in a cell in Hex
-  String csv_row = String(sensor_id, HEX) + ",";
-
-  uint32_t sensor_id_temp = sensor_id;
-  uint8_t id_offset = 0;
-  for (int i = 0; i < 32; i++) {
-    if (sensor_id_temp & (1 << i)) {
-      id_offset = i;
-    }
-  }
-
-  // millis decode
-  // the words aren't aligned because of the uint16_t len
-  // so casting will crash the pico
-  uint32_t r_now;
-  memcpy(&r_now, temp_packet, sizeof(uint32_t));
-
-  temp_packet += sizeof(r_now);
-  csv_row += String(r_now) + ",";
-
-  int curr_offset = id_offset - 1;
-  while (curr_offset >= 0) {
-    if (sensor_id & (1 << curr_offset)) {
-      // log_core("\tDecoding " + sensors[id_offset - curr_offset -
-      // 1]->getDeviceName());
-      csv_row += sensors[id_offset - curr_offset - 1]->decodeToCSV(temp_packet);
-    } else if (sensors[id_offset - curr_offset - 1]->getVerified()) {
-      csv_row += sensors[id_offset - curr_offset - 1]->readEmpty();
-    } else {
-    }
-    curr_offset--;
-  }
-
-  // check parity
-  uint8_t sum = 0;
-  for (uint16_t i = 0; i < packet_len - 1; i++) {
-    sum += packet[i];
-  }
-  sum += *(int8_t*)(packet + packet_len - 1);
-  log_core_printf("Sum = %d\n", sum);
-
-  return csv_row;
-}
-
 /**
  * @brief Read data from each verified Sensor
  *
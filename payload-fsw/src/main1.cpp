@@ -17,21 +17,36 @@ int verifyStorage();
 int verifyStorageRecovery();
 void storeData(String data);
 void storeDataPacket(uint8_t* packet);
+int drainStorages();
+void replayPackets();
 
 // include storage headers here
+#include "FlashStorage.h"
 #include "SDStorage.h"
 
 // storage classes
 SDStorage sd_storage;
+FlashStorage flash_storage;
 
 // storage array
-Storage* storages[] = {&sd_storage};
+Storage* storages[] = {&sd_storage, &flash_storage};
 
 const int storages_len = sizeof(storages) / sizeof(storages[0]);
 
 // Global variables shared with core 0
 extern queue_t qt;
 
+#if PACKET_REPLAY
+#include "Packet.h"
+#include "PacketReplay.h"
+
+PacketReplay packet_replay(PACKET_REPLAY_TIME_SCALE);
+
+// sensors are only used for decoding
+extern Sensor* sensors[];
+extern const int sensors_len;
+#endif
+
 // separate 8k stacks
 bool core1_separate_stack = true;
 
@@ -53,6 +68,10 @@ void real_setup1() {
     storages[i]->recoveryConfig(-1, 1000);
   }
 
+  // per storage queues, the SD card keeps the most recent data if it stalls
+  sd_storage.queueConfig(STORAGE_QUEUE_LEN, DropPolicy::DROP_OLDEST);
+  flash_storage.queueConfig(STORAGE_QUEUE_LEN, DropPolicy::DROP_OLDEST);
+
   // verify storage
   log_core("Verifying storage...");
   int verified_count = verifyStorageRecovery();
@@ -61,19 +80,39 @@ void real_setup1() {
     ErrorDisplay::instance().addCode(Error::CRITICAL_FAIL);
   }
 
+#if FLASH_STORAGE_DUMP
+  if (sd_storage.getVerified() && flash_storage.getVerified()) {
+    File dump_file = SD.open("FLASHLOG.BIN", FILE_WRITE);
+    if (dump_file) {
+      flash_storage.dump(dump_file);
+      dump_file.close();
+    }
+  }
+#endif
+
+#if PACKET_REPLAY
+  packet_replay.begin(PACKET_REPLAY_FILE);
+#endif
+
   delay(500);  // wait for other setup to run
   watchdog_enable(8000, true);
 }
 
 int it2 = 0;
 uint8_t received_data[QT_ENTRY_SIZE];
+unsigned long last_stats_log = 0;
 /**
  * @brief Loop for core 1
  *
  */
 void real_loop1() {
-  // Block if data is in the queue
-  if (queue_get_level(&qt) > 0) {
+#if PACKET_REPLAY
+  replayPackets();
+  return;
+#endif
+
+  // fan every waiting packet out to the storage queues
+  while (queue_try_remove(&qt, received_data)) {
     // toggle heartbeat
     it2++;
     digitalWrite(HEARTBEAT_PIN_1, (it2 & 0x1));
@@ -81,9 +120,6 @@ void real_loop1() {
 
     log_core("it2: " + String(it2));
 
-    // Retrieve sensor data from queue
-    queue_remove_blocking(&qt, received_data);
-
     unsigned long timestamp;
     memcpy(
         &timestamp,
@@ -91,12 +127,28 @@ void real_loop1() {
         sizeof(timestamp));
     log_core("Packet Received with Millis = " + String(timestamp));
 
-    // store csv row
+    // queue packet for each storage
     storeDataPacket(received_data);
   }
 
-  // Prevent a busy loop
-  delay(10);
+  // write a bounded number of packets to each storage
+  int stored = drainStorages();
+
+  if (millis() - last_stats_log >= STORAGE_STATS_LOG_PERIOD) {
+    last_stats_log = millis();
+    for (int i = 0; i < storages_len; i++) storages[i]->logStats();
+    flash_storage.logFlashStats();
+  }
+
+  // idle, let storages do background work
+  if (stored == 0) {
+    for (int i = 0; i < storages_len; i++) {
+      if (storages[i]->getVerified()) storages[i]->maintain();
+    }
+
+    // Prevent a busy loop
+    delay(10);
+  }
 }
 
 /**
@@ -143,26 +195,79 @@ int verifyStorage() {
  */
 void storeData(String data) {
   for (int i = 0; i < storages_len; i++) {
-    if (storages[i]->attemptConnection()) {
+    if (storages[i]->stepVerify()) {
       storages[i]->store(data);
     }
   }
 }
 
 /**
- * @brief Sends data to each storage device
+ * @brief Queues a packet for each storage device, the write happens in
+ * drainStorages()
  *
  * @param packet Pointer to packet bytes
  */
 void storeDataPacket(uint8_t* packet) {
-  // pull length of packet out
-  uint16_t packet_len;
-  memcpy(&packet_len, packet + sizeof(SYNC_BYTES) + sizeof(uint32_t),
-         sizeof(uint16_t));
+  for (int i = 0; i < storages_len; i++) {
+    storages[i]->enqueuePacket(packet);
+  }
+}
 
+/**
+ * @brief Writes queued packets round robin, each storage gets at most
+ * STORAGE_DRAIN_BUDGET packets and STORAGE_DRAIN_BUDGET_US per call so one
+ * slow storage can't starve the rest. An unverified storage instead runs one
+ * short step of its reverification
+ *
+ * @return int Total number of packets written
+ */
+int drainStorages() {
+  int count = 0;
   for (int i = 0; i < storages_len; i++) {
-    if (storages[i]->attemptConnection()) {
-      storages[i]->storePacket(packet);
+    if (!storages[i]->getVerified()) {
+      storages[i]->stepVerify();
+      continue;
     }
+    count += storages[i]->drain(STORAGE_DRAIN_BUDGET, STORAGE_DRAIN_BUDGET_US);
   }
-}
\ No newline at end of file
+  return count;
+}
+
+#if PACKET_REPLAY
+uint8_t replay_data[QT_ENTRY_SIZE];
+bool replay_reported = false;
+/**
+ * @brief Pushes the next due recorded packet through storage and decoding in
+ * place of the packets from core 0
+ *
+ */
+void replayPackets() {
+  // live packets are dropped while replaying
+  while (queue_try_remove(&qt, received_data));
+  watchdog_update();
+
+  uint16_t packet_len = packet_replay.nextPacket(replay_data);
+  if (packet_len == 0) {
+    if (packet_replay.done() && !replay_reported) {
+      log_core("Replay finished");
+      packet_replay.logStats();
+      replay_reported = true;
+    }
+    delay(1);
+    return;
+  }
+
+  // toggle heartbeat
+  it2++;
+  digitalWrite(HEARTBEAT_PIN_1, (it2 & 0x1));
+
+  storeDataPacket(replay_data);
+  drainStorages();
+  String csv_row = decodePacket(sensors, sensors_len, replay_data);
+
+  if (it2 % PACKET_REPLAY_LOG_PERIOD == 0) {
+    log_core("Replayed: " + csv_row);
+    packet_replay.logStats();
+  }
+}
+#endif
@@ -0,0 +1,155 @@
+// Checks CsvWriter's number formatting, in particular that
+// appendFloatShortest round trips with the fewest decimal places. Build and
+// run with make -C payload-fsw/test
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CsvWriter.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                     \
+  do {                                                       \
+    if (!(cond)) {                                           \
+      printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+      printf(__VA_ARGS__);                                   \
+      printf("\n");                                          \
+      failures++;                                            \
+    }                                                        \
+  } while (0)
+
+static const char* shortest(float value) {
+  static char buffer[64];
+  CsvWriter csv(buffer, sizeof(buffer));
+  csv.appendFloatShortest(value);
+  return buffer;
+}
+
+static void expect_shortest(float value, const char* expected) {
+  const char* got = shortest(value);
+  CHECK(strcmp(got, expected) == 0, "%.9g gave %s, expected %s", value, got,
+        expected);
+}
+
+// parses back to the same bits, and in fixed notation one decimal place
+// fewer would not
+static bool round_trips(float value, const char* text) {
+  float parsed = strtof(text, nullptr);
+  if (memcmp(&parsed, &value, sizeof(value)) != 0) return false;
+
+  const char* point = strchr(text, '.');
+  if (point == nullptr || strchr(text, 'e') != nullptr) return true;
+  int places = strlen(point + 1);
+  char fewer[64];
+  snprintf(fewer, sizeof(fewer), "%.*f", places - 1, value);
+  return strtof(fewer, nullptr) != value;
+}
+
+static void test_special() {
+  expect_shortest(0.0f, "0");
+  expect_shortest(-0.0f, "-0");
+  expect_shortest(NAN, "nan");
+  expect_shortest(INFINITY, "inf");
+  expect_shortest(-INFINITY, "-inf");
+}
+
+static void test_shortest() {
+  expect_shortest(1.0f, "1");
+  expect_shortest(-2.5f, "-2.5");
+  expect_shortest(0.1f, "0.1");
+  expect_shortest(1.05f, "1.05");
+  expect_shortest(101325.0f, "101325");
+  expect_shortest(23.47f, "23.47");
+  // rounding at fewer places carries into the whole part
+  // the literal rounds to 9.99999905, which 5 places would carry to 10
+  expect_shortest(9.9999995f, "9.999999");
+  expect_shortest(0.99999994f, "0.99999994");
+  expect_shortest(1.9999999f, "1.9999999");
+  expect_shortest(999999.94f, "999999.94");
+  // small values stay in fixed notation while 12 places are enough
+  expect_shortest(1e-10f, "0.0000000001");
+  expect_shortest(0.000123f, "0.000123");
+}
+
+static void test_exponents() {
+  const float values[] = {1e9f,    -3.4028235e38f, 1.17549435e-38f,
+                          1e-45f,  123456789e3f,   6.02214076e23f,
+                          1.5e-12f};
+  for (float value : values) {
+    const char* text = shortest(value);
+    CHECK(round_trips(value, text), "%.9g gave %s", value, text);
+  }
+  expect_shortest(1e9f, "1e+09");
+  expect_shortest(3.4028235e38f, "3.40282347e+38");
+}
+
+// every 4099th bit pattern covers each exponent with many mantissas
+static void test_round_trip_sweep() {
+  uint32_t checked = 0;
+  for (uint64_t bits = 0; bits <= 0xFFFFFFFFULL; bits += 4099) {
+    uint32_t word = (uint32_t)bits;
+    float value;
+    memcpy(&value, &word, sizeof(value));
+    if (isnan(value) || isinf(value)) continue;
+    const char* text = shortest(value);
+    if (!round_trips(value, text)) {
+      CHECK(false, "0x%08x (%.9g) gave %s", word, value, text);
+      if (failures > 20) return;
+    }
+    checked++;
+  }
+  printf("round trip: %u floats\n", checked);
+}
+
+static void test_fixed() {
+  char buffer[128];
+  CsvWriter csv(buffer, sizeof(buffer));
+  csv.addFloat(3.14159, 2).addFloat(-0.0051, 2).addFloat(2.5, 0);
+  csv.addFloat(1e20, 1).addInt(-2147483647 - 1).addUInt(4294967295u);
+  csv.appendHex(0xbeef);
+  CHECK(strcmp(buffer, "3.14,-0.01,2,100000000000000000000.0,-2147483648,"
+                       "4294967295,beef") == 0,
+        "%s", buffer);
+  CHECK(!csv.overflow(), "overflow");
+}
+
+static void test_overflow() {
+  char buffer[8];
+  CsvWriter csv(buffer, sizeof(buffer));
+  csv.addFloatShortest(1.5f);
+  CHECK(!csv.overflow() && strcmp(buffer, "1.5,") == 0, "%s", buffer);
+  csv.addFloatShortest(-2.25f);
+  CHECK(csv.overflow(), "no overflow at %zu bytes", csv.size());
+  CHECK(csv.size() == sizeof(buffer) - 1 && buffer[csv.size()] == '\0',
+        "truncated to %zu", csv.size());
+  CHECK(strcmp(buffer, "1.5,-2.") == 0, "%s", buffer);
+
+  csv.clear();
+  CHECK(!csv.overflow() && csv.size() == 0 && buffer[0] == '\0', "clear");
+  csv.appendFloatShortest(3.4028235e38f);
+  CHECK(csv.overflow() && strcmp(buffer, "3.40282") == 0, "exponent %s",
+        buffer);
+
+  CsvWriter empty(buffer, 0);
+  empty.appendRaw("x");
+  CHECK(empty.overflow() && empty.size() == 0, "zero capacity");
+}
+
+int main() {
+  test_special();
+  test_shortest();
+  test_exponents();
+  test_round_trip_sweep();
+  test_fixed();
+  test_overflow();
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all passed\n");
+  return 0;
+}
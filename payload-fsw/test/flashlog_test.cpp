@@ -0,0 +1,178 @@
+// Exercises FlashLog against SimFlashBackend: ring wrap, corrupted pages and
+// power cuts. Build and run with make -C payload-fsw/test
+
+#include <stdio.h>
+#include <string.h>
+
+#include <vector>
+
+#include "FlashLog.h"
+#include "SimFlashBackend.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                     \
+  do {                                                       \
+    if (!(cond)) {                                           \
+      printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+      printf(__VA_ARGS__);                                   \
+      printf("\n");                                          \
+      failures++;                                            \
+    }                                                        \
+  } while (0)
+
+/**
+ * @brief Builds a packet framed like Packet.h, the id in the sensor presence
+ * field and an int8 sum complement checksum in the last byte
+ *
+ */
+static void make_packet(uint32_t id, uint16_t len, uint8_t* out) {
+  memcpy(out, "ASU!", 4);
+  memcpy(out + 4, &id, sizeof(id));
+  memcpy(out + 8, &len, sizeof(len));
+  for (uint16_t i = 10; i < len - 1; i++) out[i] = (uint8_t)(id * 31 + i);
+  int8_t sum = 0;
+  for (uint16_t i = 0; i < len - 1; i++) sum += (int8_t)out[i];
+  out[len - 1] = (uint8_t)-sum;
+}
+
+static std::vector<uint32_t> read_ids(FlashLog& log) {
+  std::vector<uint32_t> ids;
+  uint8_t packet[FLASH_LOG_MAX_PACKET];
+  uint16_t len;
+  FlashLogCursor cursor = {0, 0};
+  while (log.readPacket(cursor, packet, sizeof(packet), len)) {
+    uint32_t id;
+    memcpy(&id, packet + 4, sizeof(id));
+    ids.push_back(id);
+  }
+  return ids;
+}
+
+static bool consecutive(const std::vector<uint32_t>& ids, size_t from,
+                        size_t to) {
+  for (size_t i = from + 1; i < to; i++) {
+    if (ids[i] != ids[i - 1] + 1) return false;
+  }
+  return true;
+}
+
+static void append_range(FlashLog& log, uint32_t first, uint32_t count,
+                         uint16_t len) {
+  uint8_t packet[FLASH_LOG_MAX_PACKET];
+  for (uint32_t id = first; id < first + count; id++) {
+    make_packet(id, len, packet);
+    log.append(packet, len);
+  }
+}
+
+// after a wrap the oldest sector starts mid-packet
+static void test_wrap() {
+  const uint32_t sectors = 8;
+  const uint16_t len = 110;
+  const uint32_t count = 400;
+
+  SimFlashBackend sim(sectors);
+  FlashLog log(sim);
+  CHECK(log.recover(), "recover");
+  append_range(log, 0, count, len);
+  CHECK(log.flush(), "flush");
+
+  std::vector<uint32_t> ids = read_ids(log);
+  // every whole packet in the seven older sectors and the head's pages
+  uint32_t min_expected =
+      (sectors - 1) * (FLASH_LOG_SECTOR_SIZE - FLASH_LOG_HEADER_SIZE) / len -
+      1;
+  CHECK(ids.size() >= min_expected, "%zu packets, expected >= %u", ids.size(),
+        min_expected);
+  CHECK(!ids.empty() && ids.back() == count - 1, "last id %u",
+        ids.empty() ? 0 : ids.back());
+  CHECK(consecutive(ids, 0, ids.size()), "gap in ids");
+  printf("wrap: %zu of %u packets, ids %u-%u\n", ids.size(), count,
+         ids.empty() ? 0 : ids.front(), ids.empty() ? 0 : ids.back());
+}
+
+// clearing bits in one page only loses the packets touching it
+static void test_corrupt_page(uint16_t len) {
+  const uint32_t sectors = 8;
+  const uint32_t count =
+      6 * (FLASH_LOG_SECTOR_SIZE - FLASH_LOG_HEADER_SIZE) / len;
+
+  SimFlashBackend sim(sectors);
+  FlashLog log(sim);
+  CHECK(log.recover(), "recover");
+  append_range(log, 0, count, len);
+  CHECK(log.flush(), "flush");
+
+  // zero the data of page 0, keeping the sector header intact
+  uint8_t page[FLASH_LOG_PAGE_SIZE];
+  memset(page, 0x00, sizeof(page));
+  memset(page, 0xFF, FLASH_LOG_HEADER_SIZE);
+  CHECK(sim.programPage(0, page), "corrupt");
+
+  std::vector<uint32_t> ids = read_ids(log);
+  uint32_t lost_max =
+      (FLASH_LOG_PAGE_SIZE - FLASH_LOG_HEADER_SIZE) / len + 2;
+  CHECK(ids.size() + lost_max >= count, "%zu of %u packets", ids.size(),
+        count);
+  CHECK(!ids.empty() && ids.back() == count - 1, "last id");
+  CHECK(consecutive(ids, 0, ids.size()), "gap in ids");
+  printf("corrupt page 0, %u B packets: %zu of %u packets\n", len,
+         ids.size(), count);
+}
+
+// a cut during any erase or program keeps every flushed packet and the log
+// keeps working after the reboot
+static void test_power_cut() {
+  const uint32_t sectors = 8;
+  const uint16_t len = 100;
+  const uint32_t flushed = 60;
+  const uint32_t after_reboot = 50;
+
+  for (int32_t cut = 0; cut < 60; cut++) {
+    SimFlashBackend sim(sectors);
+    FlashLog log(sim);
+    CHECK(log.recover(), "recover");
+    append_range(log, 0, flushed, len);
+    CHECK(log.flush(), "flush");
+
+    sim.cutPowerAfter(cut);
+    uint8_t packet[FLASH_LOG_MAX_PACKET];
+    for (uint32_t id = flushed; id < 400 && sim.isPowered(); id++) {
+      make_packet(id, len, packet);
+      log.append(packet, len);
+      if (id % 5 == 0) log.maintain();
+    }
+
+    sim.powerOn();
+    FlashLog rebooted(sim);
+    CHECK(rebooted.recover(), "recover after cut %d", cut);
+    append_range(rebooted, 1000, after_reboot, len);
+    CHECK(rebooted.flush(), "flush after cut %d", cut);
+
+    std::vector<uint32_t> ids = read_ids(rebooted);
+    size_t split = 0;
+    while (split < ids.size() && ids[split] < 1000) split++;
+    CHECK(split >= flushed && !ids.empty() && ids[0] == 0,
+          "cut %d: %zu packets before", cut, split);
+    CHECK(consecutive(ids, 0, split), "cut %d: gap before the cut", cut);
+    CHECK(ids.size() - split == after_reboot, "cut %d: %zu packets after",
+          cut, ids.size() - split);
+    CHECK(consecutive(ids, split, ids.size()), "cut %d: gap after", cut);
+  }
+  printf("power cut: 60 cut points\n");
+}
+
+int main() {
+  test_wrap();
+  test_corrupt_page(110);
+  test_corrupt_page(127);
+  test_power_cut();
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all passed\n");
+  return 0;
+}
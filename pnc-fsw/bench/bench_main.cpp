@@ -0,0 +1,333 @@
+/**
+ * @file bench_main.cpp
+ * @brief Micro-benchmarks for the RadiaCode decode hot paths, built with the
+ * bench env
+ *
+ * Flash with `pio run -e bench -t upload` and read the report over Serial.
+ * Spectrum and DATA_BUF payloads are synthesized in the RadiaCode wire format
+ * so no device has to be connected. The emulated_* benches send real requests
+ * to an RCEmulator, timing the framing and reassembly along with the decode.
+ */
+#include <Arduino.h>
+
+#include "Bench.h"
+#include "RCEmulator.h"
+#include "RadiacodeBLE.h"
+
+#define BENCH_BUFFER_SIZE 4000
+#define SPECTRUM_BINS 1024
+#define DATA_BUF_RECORDS 24
+
+static uint8_t spectrum_bytes[BENCH_BUFFER_SIZE];
+static size_t spectrum_bytes_len = 0;
+static uint8_t data_buf_bytes[BENCH_BUFFER_SIZE];
+static size_t data_buf_bytes_len = 0;
+static uint8_t scratch[BENCH_BUFFER_SIZE];
+static int spectrum[SPECTRUM_BINS];
+
+static BytesBuffer buf_a(BENCH_BUFFER_SIZE);
+static BytesBuffer buf_b(BENCH_BUFFER_SIZE);
+
+static RCEmulator emulator;
+
+template <typename T>
+static void append(uint8_t*& pos, T value) {
+  memcpy(pos, &value, sizeof(T));
+  pos += sizeof(T);
+}
+
+/**
+ * @brief The per-value consume<T>() spectrum decoder decode_spectrum replaced,
+ * kept to compare against
+ *
+ */
+static uint8_t legacyDecodeSpectrum(BytesBuffer* data, int* ret, float& a0,
+                                    float& a1, float& a2, uint32_t& ts) {
+  ts = data->consume<uint32_t>();
+  a0 = data->consume<float>();
+  a1 = data->consume<float>();
+  a2 = data->consume<float>();
+
+  size_t ret_it = 0;
+  int last = 0;
+  int v = 0;
+  while (data->empty() == false) {
+    uint16_t u16 = data->consume<uint16_t>();
+    uint16_t cnt = (u16 >> 4) & 0x0FFF;
+    uint16_t vlen = u16 & 0x0F;
+
+    for (int i = 0; i < cnt; i++) {
+      if (vlen == 0) {
+        v = 0;
+      } else if (vlen == 1) {
+        v = data->consume<uint8_t>();
+      } else if (vlen == 2) {
+        v = last + data->consume<int8_t>();
+      } else if (vlen == 3) {
+        v = last + data->consume<int16_t>();
+      } else if (vlen == 4) {
+        uint8_t a = data->consume<uint8_t>();
+        uint8_t b = data->consume<uint8_t>();
+        int8_t c = data->consume<int8_t>();
+        v = last + ((c << 16) | (b << 8) | a);
+      } else if (vlen == 5) {
+        v = last + data->consume<int32_t>();
+      } else {
+        return 1;
+      }
+
+      last = v;
+      ret[ret_it++] = v;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Writes a DATA_BUF record header
+ *
+ */
+static void appendRecordHeader(uint8_t*& pos, uint8_t seq, uint8_t eid,
+                               uint8_t gid, int32_t ts_offset) {
+  append<uint8_t>(pos, seq);
+  append<uint8_t>(pos, eid);
+  append<uint8_t>(pos, gid);
+  append<int32_t>(pos, ts_offset);
+}
+
+/**
+ * @brief Builds a DATA_BUF payload with a flight-like mix of record types
+ *
+ * @param out Output bytes
+ * @param records Number of records
+ * @return size_t Number of bytes written
+ */
+static size_t encodeDataBuf(uint8_t* out, int records) {
+  uint8_t* pos = out;
+  for (int i = 0; i < records; i++) {
+    switch (i % 4) {
+      case 0:  // RealTimeData
+        appendRecordHeader(pos, i, 0, 0, 100 * i);
+        append<float>(pos, 7.9f + i);
+        append<float>(pos, 0.00001f * i);
+        append<uint16_t>(pos, 43);
+        append<uint16_t>(pos, 177);
+        append<uint16_t>(pos, 64);
+        append<uint8_t>(pos, 0);
+        break;
+      case 1:  // DoseRateDB
+        appendRecordHeader(pos, i, 0, 2, 100 * i);
+        append<uint32_t>(pos, 740 + i);
+        append<float>(pos, 7.7f);
+        append<float>(pos, 0.00001f);
+        append<uint16_t>(pos, 278);
+        append<uint16_t>(pos, 4096);
+        break;
+      case 2:  // RareData
+        appendRecordHeader(pos, i, 0, 3, 100 * i);
+        append<uint32_t>(pos, 417514);
+        append<float>(pos, 0.00234f);
+        append<uint16_t>(pos, 4765);
+        append<uint16_t>(pos, 9278);
+        append<uint16_t>(pos, 4160);
+        break;
+      default:  // Event
+        appendRecordHeader(pos, i, 0, 7, 100 * i);
+        append<uint8_t>(pos, 2);
+        append<uint8_t>(pos, 1);
+        append<uint16_t>(pos, 0);
+        break;
+    }
+  }
+  return pos - out;
+}
+
+void setup() {
+  Serial.begin(115200);
+  while (!Serial) delay(10);
+  delay(1000);
+
+  // background falloff with a photopeak, like a Cs-137 check source
+  for (int i = 0; i < SPECTRUM_BINS; i++) {
+    float peak = (i - 220) * (i - 220) / 50.0f;
+    spectrum[i] = (int)(2000 * expf(-i / 150.0f) + 500 * expf(-peak));
+  }
+  spectrum_bytes_len =
+      RCEmulator::encode_spectrum(spectrum, SPECTRUM_BINS, 1234, -6.5f, 2.41f,
+                                  0.0004f, spectrum_bytes, BENCH_BUFFER_SIZE);
+  data_buf_bytes_len = encodeDataBuf(data_buf_bytes, DATA_BUF_RECORDS);
+  for (size_t i = 0; i < sizeof(scratch); i++) scratch[i] = i;
+
+  benchHeader("pnc-fsw radiacode");
+  log_printf("# spectrum %u bytes, data_buf %u bytes (%d records)\n",
+             spectrum_bytes_len, data_buf_bytes_len, DATA_BUF_RECORDS);
+
+  runBench("BytesBuffer_fill_drain_64", 20000, [] {
+    buf_a.fill(scratch, 64);
+    buf_a.drain(scratch + 64, 64);
+  });
+
+  runBench("BytesBuffer_fill_256", 5000, [] {
+    buf_a.clear();
+    buf_a.fill(scratch, 256);
+  });
+
+  runBench("BytesBuffer_fill_256_consume_64xu32", 5000, [] {
+    buf_a.clear();
+    buf_a.fill(scratch, 256);
+    uint32_t sum = 0;
+    for (int i = 0; i < 64; i++) sum += buf_a.consume<uint32_t>();
+    benchSink(sum);
+  });
+
+  runBench("BytesBuffer_fill_256_consume_array_64xu32", 5000, [] {
+    uint32_t values[64];
+    buf_a.clear();
+    buf_a.fill(scratch, 256);
+    benchSink(buf_a.consume_array(values, 64));
+    benchSink(values[63]);
+  });
+
+  runBench("BytesBuffer_fill_256_try_consume_64xu32", 5000, [] {
+    buf_a.clear();
+    buf_a.fill(scratch, 256);
+    uint32_t sum = 0;
+    uint32_t v;
+    while (buf_a.try_consume(v)) sum += v;
+    benchSink(sum);
+  });
+
+  runBench("BytesBuffer_span_wrapped_256", 2000, [] {
+    // 256 bytes straddling the end, span() has to unwrap them
+    buf_a.clear();
+    buf_a.fill(scratch, BENCH_BUFFER_SIZE - 128);
+    buf_a.drain(nullptr, BENCH_BUFFER_SIZE - 128);
+    buf_a.fill(scratch, 256);
+    benchSink(buf_a.span().data[255]);
+  });
+
+  buf_b.clear();
+  buf_b.fill(scratch, 512);
+  runBench("BytesBuffer_copy", 2000, [] { buf_a.copy(buf_b); });
+
+  runBench("spectrum_fill", 2000, [] {
+    buf_a.clear();
+    buf_a.fill(spectrum_bytes, spectrum_bytes_len);
+  });
+
+  runBench("decode_spectrum", 500, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    buf_a.clear();
+    buf_a.fill(spectrum_bytes, spectrum_bytes_len);
+    benchSink(decode_spectrum(&buf_a, spectrum, a0, a1, a2, ts));
+  });
+
+  runBench("accumulate_spectrum", 500, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    buf_a.clear();
+    buf_a.fill(spectrum_bytes, spectrum_bytes_len);
+    benchSink(accumulate_spectrum(&buf_a, spectrum, a0, a1, a2, ts));
+  });
+
+  runBench("decode_spectrum_legacy", 500, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    buf_a.clear();
+    buf_a.fill(spectrum_bytes, spectrum_bytes_len);
+    benchSink(legacyDecodeSpectrum(&buf_a, spectrum, a0, a1, a2, ts));
+  });
+
+  runBench("data_buf_fill", 5000, [] {
+    buf_a.clear();
+    buf_a.fill(data_buf_bytes, data_buf_bytes_len);
+  });
+
+  runBench("consume_data_buf", 2000, [] {
+    buf_a.clear();
+    buf_a.fill(data_buf_bytes, data_buf_bytes_len);
+    while (buf_a.size() >= 7) benchSink(consume_data_buf(&buf_a).index());
+  });
+
+  runBench("consume_data_buf_to_string", 500, [] {
+    char str[500];
+    buf_a.clear();
+    buf_a.fill(data_buf_bytes, data_buf_bytes_len);
+    while (buf_a.size() >= 7) {
+      DataPoint d = consume_data_buf(&buf_a);
+      std::visit([&str](const auto& v) { benchSink(v.to_string(str, 500)); },
+                 d);
+    }
+  });
+
+  runBench("consume_data_buf_to_record", 2000, [] {
+    buf_a.clear();
+    buf_a.fill(data_buf_bytes, data_buf_bytes_len);
+    size_t used = 0;
+    while (buf_a.size() >= 7) {
+      used += data_point_to_record(consume_data_buf(&buf_a), 1234,
+                                   scratch + used);
+    }
+    benchSink(used);
+  });
+
+  radiacode_ble_init();
+  rc_set_transport(&emulator);
+  emulator.set_spectrum(spectrum, SPECTRUM_BINS, 1234, -6.5f, 2.41f, 0.0004f);
+
+  runBench("emulated_read_data_buf", 500, [] {
+    emulator.queue_data_buf(data_buf_bytes, data_buf_bytes_len);
+    BytesBuffer* r = read_request(VS::DATA_BUF);
+    while (r != nullptr && r->size() >= 7) {
+      benchSink(consume_data_buf(r).index());
+    }
+  });
+
+  // response encoding in the emulator is part of these
+  runBench("emulated_read_spectrum", 200, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    benchSink(decode_spectrum(readSpectrumData(), spectrum, a0, a1, a2, ts));
+  });
+
+  runBench("emulated_read_data_buf_spectrum_pipelined", 200, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    emulator.queue_data_buf(data_buf_bytes, data_buf_bytes_len);
+    int data_req = read_request_async(VS::DATA_BUF);
+    int spec_req = read_request_async(VS::SPECTRUM);
+    BytesBuffer* r = read_request_wait(data_req);
+    while (r != nullptr && r->size() >= 7) {
+      benchSink(consume_data_buf(r).index());
+    }
+    rc_request_release(data_req);
+    benchSink(decode_spectrum(read_request_wait(spec_req), spectrum, a0, a1,
+                              a2, ts));
+    rc_request_release(spec_req);
+  });
+
+  // reassembly cost at a 247 byte MTU and at its worst, one byte at a time
+  emulator.set_notify_size(244);
+  runBench("emulated_read_spectrum_notify_244", 200, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    benchSink(decode_spectrum(readSpectrumData(), spectrum, a0, a1, a2, ts));
+  });
+  emulator.set_notify_size(1);
+  runBench("emulated_read_spectrum_notify_1", 20, [] {
+    float a0, a1, a2;
+    uint32_t ts;
+    benchSink(decode_spectrum(readSpectrumData(), spectrum, a0, a1, a2, ts));
+  });
+
+  RCBleStats stats;
+  rc_ble_get_stats(&stats, false);
+  log_printf("# emulator: %lu requests, %lu failed, %lu notifications\n",
+             stats.requests, stats.failures, stats.notifications);
+
+  log_printf("# done\n");
+}
+
+void loop() { delay(1000); }
@@ -6,6 +6,9 @@
 #define ERROR_2_PIN 22
 #define SD_PIN 17
 
+// control file holding the number of the next data/rc file pair
+#define SD_BOOT_COUNT_FILE "boot.cnt"
+
 // max resolution for the rp2350's ADC
 #define PICO_TEMP_ADC_RES 12
 
@@ -17,7 +17,7 @@ static inline void log_task_error(String str) {
   Serial.print("[ERROR - " + String(get_core_num()) + "] " + str + "\n");
 }
 
-static inline void log_data_raw(const uint8_t* packet, const uint8_t len) {
+static inline void log_data_raw(const uint8_t* packet, const size_t len) {
   Serial.write((const char*)packet, len);
 }
 
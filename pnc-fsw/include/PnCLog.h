@@ -0,0 +1,84 @@
+#ifndef PNC_LOG_H
+#define PNC_LOG_H
+
+#include <Arduino.h>
+
+#include "SysVar.h"
+
+/** @brief "PNCH" in the file, starts the schema header at the file start */
+#define PNC_LOG_HEADER_SYNC 0x48434E50
+/** @brief "PNCR" in the file, marks the start of every record */
+#define PNC_RECORD_SYNC 0x52434E50
+#define PNC_LOG_VERSION 1
+
+/** @brief Longest group name in the schema, NUL padded */
+#define PNC_LOG_NAME_SIZE 13
+
+/**
+ * @brief Fixed start of the schema header written once at the start of a
+ * data file
+ *
+ * The header is followed by group_count PnCLogGroup entries and an int8_t sum
+ * complement checksum over the whole header.
+ */
+struct __attribute__((packed)) PnCLogHeader {
+  uint32_t sync = PNC_LOG_HEADER_SYNC;
+  uint8_t version = PNC_LOG_VERSION;
+  uint8_t group_count;
+  uint16_t length;  // whole header, entries and checksum included
+};
+
+/**
+ * @brief Schema entry for one SysVar group, the bit and layout records use
+ * for it
+ *
+ */
+struct __attribute__((packed)) PnCLogGroup {
+  uint8_t id;     // SysVarId, its bit in PnCRecordHeader::present
+  uint16_t size;  // bytes the group takes in a record
+  char name[PNC_LOG_NAME_SIZE];
+};
+
+/**
+ * @brief Fixed start of every record
+ *
+ * The header is followed by the raw value of every group in present, in
+ * SysVarId order, and an int8_t sum complement checksum over the whole
+ * record.
+ */
+struct __attribute__((packed)) PnCRecordHeader {
+  uint32_t sync = PNC_RECORD_SYNC;
+  uint8_t version = PNC_LOG_VERSION;
+  uint8_t reserved = 0;
+  uint16_t length;  // whole record, header and checksum included
+  uint32_t uptime;
+  uint32_t present;  // 1 << SysVarId for each group in the record
+};
+
+#define PNC_LOG_HEADER_SIZE                                    \
+  (sizeof(PnCLogHeader) + SYSVAR_COUNT * sizeof(PnCLogGroup) + \
+   sizeof(int8_t))
+
+#define PNC_GROUP_SIZE(name, type) +sizeof(type)
+/** @brief Record with every group present */
+#define PNC_RECORD_MAX_SIZE \
+  (sizeof(PnCRecordHeader) SYSVAR_LIST(PNC_GROUP_SIZE) + sizeof(int8_t))
+
+/**
+ * @brief Encodes SysVar snapshots as records holding only the groups written
+ * since the previous record, so each is decoded by carrying the other groups
+ * forward from earlier records
+ *
+ */
+class PnCLog {
+ private:
+  bool full_next;
+
+ public:
+  PnCLog();
+  static size_t encode_header(uint8_t* out);
+  size_t encode(const SysVarSnapshot& snapshot, uint32_t uptime, uint8_t* out);
+  void reset();
+};
+
+#endif
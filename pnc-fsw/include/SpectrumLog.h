@@ -0,0 +1,75 @@
+#ifndef SPECTRUM_LOG_H
+#define SPECTRUM_LOG_H
+
+#include <Arduino.h>
+
+/** @brief "SPEC" in the file, marks the start of every spectrum record */
+#define SPECTRUM_RECORD_SYNC 0x43455053
+#define SPECTRUM_RECORD_VERSION 2
+
+/** @brief Largest spectrum the log can hold */
+#define SPECTRUM_LOG_MAX_CHANNELS 1024
+
+typedef enum : uint8_t {
+  SPECTRUM_KEYFRAME = 0,  // counts relative to zero
+  SPECTRUM_DELTA = 1      // counts relative to the previous record
+} SpectrumRecordType;
+
+/**
+ * @brief Fixed start of every spectrum record
+ *
+ * The header is followed by a SpectrumCalibration in keyframes only, then
+ * the channel values and an int8_t sum complement checksum over the whole
+ * record. The values are stored as groups of varint zero_run, varint
+ * literal_count, then literal_count zigzag varints, until every channel is
+ * covered. Version 1 records had the calibration in every header.
+ */
+struct __attribute__((packed)) SpectrumRecordHeader {
+  uint32_t sync = SPECTRUM_RECORD_SYNC;
+  uint8_t version = SPECTRUM_RECORD_VERSION;
+  uint8_t type;
+  uint16_t length;  // whole record, header and checksum included
+  uint32_t uptime;
+  uint32_t device_ts;
+  uint16_t channels;
+};
+
+/**
+ * @brief Energy calibration, deltas use their keyframe's so a change of
+ * calibration starts a new keyframe
+ *
+ */
+struct __attribute__((packed)) SpectrumCalibration {
+  float a0;
+  float a1;
+  float a2;
+};
+
+/** @brief Worst case record, every channel a 5 byte varint in its own group */
+#define SPECTRUM_RECORD_MAX_SIZE                                \
+  (sizeof(SpectrumRecordHeader) + sizeof(SpectrumCalibration) + \
+   SPECTRUM_LOG_MAX_CHANNELS * 9 + sizeof(int8_t))
+
+/**
+ * @brief Encodes successive spectra as compact binary records, storing only
+ * the change since the previous one with a keyframe every so often so a lost
+ * record only breaks the spectra up to the next keyframe
+ *
+ */
+class SpectrumLog {
+ private:
+  int32_t previous[SPECTRUM_LOG_MAX_CHANNELS];
+  SpectrumCalibration calibration;  // of the last keyframe
+  uint16_t previous_channels;
+  uint16_t keyframe_interval;
+  uint16_t since_keyframe;
+  bool has_previous;
+
+ public:
+  SpectrumLog(uint16_t keyframe_interval);
+  size_t encode(const int* spectrum, uint16_t channels, uint32_t device_ts,
+                float a0, float a1, float a2, uint8_t* out);
+  void reset();
+};
+
+#endif
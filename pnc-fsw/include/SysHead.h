@@ -13,4 +13,74 @@
 // freeRTOS
 #define TASK_PRIORITY_DEFAULT (configMAX_PRIORITIES / 2)
 
+// task priorities, sensor logging must never wait on the RadiaCode
+#define SENSORS_TASK_PRIORITY (TASK_PRIORITY_DEFAULT + 2)
+#define STORAGE_TASK_PRIORITY (TASK_PRIORITY_DEFAULT + 1)
+#define RADIACODE_TASK_PRIORITY (TASK_PRIORITY_DEFAULT)
+
+// task periods
+#define SENSORS_TASK_PERIOD_MS 200
+#define STORAGE_TASK_PERIOD_MS 200
+#define RADIACODE_TASK_PERIOD_MS 200
+
+// task stack sizes, in 4 byte words
+#define SENSORS_TASK_STACK_WORDS 1024
+#define STORAGE_TASK_STACK_WORDS 1024
+#define RADIACODE_TASK_STACK_WORDS 2048
+
+// u-blox solutions per second, each pushed as a NAV-PVT read in one I2C
+// transaction of up to GPS_I2C_TRANSACTION_SIZE bytes, rates above
+// 1000 / SENSORS_TASK_PERIOD_MS publish only the latest per period
+#define GPS_NAV_RATE_HZ 5
+#define GPS_I2C_TRANSACTION_SIZE 128
+
+// RadiaCode spectrum logging, every spectrum is a delta against the previous
+// one with a full keyframe every SPECTRUM_KEYFRAME_INTERVAL spectra
+#define SPECTRUM_PERIOD_MS 5000
+#define SPECTRUM_KEYFRAME_INTERVAL 60
+
+// the spectrum is kept by adding SPEC_DIFF reads onto a full SPECTRUM, read
+// again every SPECTRUM_BASELINE_INTERVAL diffs to correct any drift
+#define SPECTRUM_BASELINE_INTERVAL 60
+
+// RadiaCode DATA_BUF events are stored as binary records, batched through a
+// buffer of RC_RECORD_BUFFER_SIZE bytes, RC_LOG_DATA_POINTS also prints them
+#define RC_RECORD_BUFFER_SIZE 512
+#define RC_LOG_DATA_POINTS 0
+
+// RadiaCode reconnects, the backoff doubles from MIN to MAX after every
+// failed attempt, RC_MAX_FAILS failed requests in a row drop the link
+#define RC_RECONNECT_BACKOFF_MIN_MS 1000
+#define RC_RECONNECT_BACKOFF_MAX_MS 60000
+#define RC_MAX_FAILS 10
+
+// DATA_BUF is polled every RC_DATA_BUF_POLL_MIN_MS to RC_DATA_BUF_POLL_MAX_MS,
+// aiming for RC_DATA_BUF_TARGET_BYTES per read at the recent byte rate
+#define RC_DATA_BUF_POLL_MIN_MS RADIACODE_TASK_PERIOD_MS
+#define RC_DATA_BUF_POLL_MAX_MS 2000
+#define RC_DATA_BUF_TARGET_BYTES 512
+
+// period between RadiaCode BLE round trip time and throughput logs
+#define RC_STATS_LOG_PERIOD_MS 60000
+
+// dose rate, detector temperature and the accelerometer are read as one
+// RD_VIRT_SFR_BATCH alongside the DATA_BUF every RC_VSFR_PERIOD_MS
+#define RC_VSFR_PERIOD_MS 1000
+
+// the monitor prints changed SysVars as text lines, MONITOR_BINARY_TELEMETRY
+// instead writes one PnC record holding every SysVar per cycle to Serial, with
+// the schema header every MONITOR_SCHEMA_INTERVAL records, for
+// data-processing/monitor_telemetry.py
+#define MONITOR_BINARY_TELEMETRY 0
+#define MONITOR_SCHEMA_INTERVAL 10
+
+// SD writes are buffered per file and written by the storage task on core 1
+// in STORAGE_WRITE_CHUNK pieces, the rest every STORAGE_SYNC_PERIOD_MS, a
+// buffer also holds the records queued while the SD card is down
+#define STORAGE_WRITE_CHUNK 512
+#define STORAGE_SYNC_PERIOD_MS 1000
+#define STORAGE_DATA_BUFFER_SIZE 4096
+#define STORAGE_RC_BUFFER_SIZE 8192
+#define STORAGE_SPEC_BUFFER_SIZE 16384  // holds a worst case spectrum record
+
 #endif
\ No newline at end of file
@@ -2,13 +2,147 @@
 #define SYS_VAR_H
 
 #include <Arduino.h>
+#include <RadiacodeBLE.h>
 #include <drivers/BMESensor.h>
 #include <drivers/GPSSensor.h>
 #include <drivers/INASensor.h>
 
+#include <atomic>
+
+/**
+ * @brief Every system variable as X(name, type), adding a line here adds the
+ * sysvar_<name> instance, its SysVarId and its field in SysVarSnapshot
+ *
+ */
+#define SYSVAR_LIST(X)             \
+  X(pico_temp_c, float)            \
+  X(rtc_time, uint32_t)            \
+  X(ina_data, INASensorData)       \
+  X(bme_data, BMESensorData)       \
+  X(gps_data, GPSSensorData)       \
+  X(rc_realtime, RCRealTimeValues)
+
+/**
+ * @brief Index of each system variable, also its bit in SysVarSnapshot::changed
+ *
+ */
+enum SysVarId {
+#define SYSVAR_ID(name, type) SYSVAR_ID_##name,
+  SYSVAR_LIST(SYSVAR_ID)
+#undef SYSVAR_ID
+      SYSVAR_COUNT
+};
+
+// registry lock, shared by every writer and sysvar_snapshot()
+void sysvar_lock();
+void sysvar_unlock();
+
+/**
+ * @brief One system variable, a double buffered sequence lock holding the
+ * value and the millis() it was written at
+ *
+ * Writers fill the buffer readers aren't using and publish it by bumping the
+ * generation, all under the registry lock so sysvar_snapshot() sees every
+ * variable at once. get() takes no lock, it copies the published buffer and
+ * retries only if a write completed meanwhile.
+ *
+ * @tparam T Type of the value
+ */
+template <typename T>
+class SysVar {
+ private:
+  std::atomic<uint32_t> seq{0};  // completed writes, seq & 1 is published
+  T values[2] = {};
+  uint32_t timestamps_ms[2] = {};
+
+ public:
+  /**
+   * @brief Writes and publishes a new value
+   *
+   * @param value Value to write
+   */
+  void set(const T& value) {
+    sysvar_lock();
+    uint32_t s = this->seq.load(std::memory_order_relaxed);
+    // readers of the last publish must see seq change before this buffer does
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    this->values[(s + 1) & 1] = value;
+    this->timestamps_ms[(s + 1) & 1] = millis();
+    this->seq.store(s + 1, std::memory_order_release);
+    sysvar_unlock();
+  }
+
+  /**
+   * @brief Copies the latest value without blocking
+   *
+   * @param output Where to copy the value
+   * @param timestamp_ms Optional, millis() when the value was written
+   * @return uint32_t Generation of the value copied, 0 if never written
+   */
+  uint32_t get(T* output, uint32_t* timestamp_ms = nullptr) const {
+    uint32_t before, after;
+    do {
+      before = this->seq.load(std::memory_order_acquire);
+      *output = this->values[before & 1];
+      if (timestamp_ms != nullptr) {
+        *timestamp_ms = this->timestamps_ms[before & 1];
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = this->seq.load(std::memory_order_relaxed);
+    } while (before != after);
+    return before;
+  }
+
+  /**
+   * @brief Gets the number of writes so far
+   *
+   * @return uint32_t
+   */
+  uint32_t generation() const {
+    return this->seq.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Copies the published value, only valid while holding the registry
+   * lock
+   *
+   * @param output Where to copy the value
+   * @param timestamp_ms millis() when the value was written
+   * @return uint32_t Generation of the value
+   */
+  uint32_t getLocked(T* output, uint32_t* timestamp_ms) const {
+    uint32_t s = this->seq.load(std::memory_order_relaxed);
+    *output = this->values[s & 1];
+    *timestamp_ms = this->timestamps_ms[s & 1];
+    return s;
+  }
+};
+
+#define SYSVAR_EXTERN(name, type) extern SysVar<type> sysvar_##name;
+SYSVAR_LIST(SYSVAR_EXTERN)
+#undef SYSVAR_EXTERN
+
+/**
+ * @brief Copy of every system variable taken at one instant
+ *
+ * Reuse the same snapshot between calls, changed is then the set of variables
+ * written since the previous call.
+ */
+struct SysVarSnapshot {
+#define SYSVAR_FIELD(name, type) type name;
+  SYSVAR_LIST(SYSVAR_FIELD)
+#undef SYSVAR_FIELD
+  uint32_t timestamp_ms[SYSVAR_COUNT];
+  uint32_t generation[SYSVAR_COUNT];
+  uint32_t changed;  // 1 << SysVarId for each variable written since last call
+};
+
 // setup
 void sysvar_init();
 
+// whole system
+void sysvar_snapshot(SysVarSnapshot* snapshot);
+
 // Access functions
 int8_t sysvar_get_pico_temp_c(float* output);
 int8_t sysvar_set_pico_temp_c(float input);
@@ -25,4 +159,7 @@ int8_t sysvar_get_bme_data(BMESensorData* sensor_data);
 int8_t sysvar_set_gps_data(GPSSensorData* sensor_data);
 int8_t sysvar_get_gps_data(GPSSensorData* sensor_data);
 
+int8_t sysvar_set_rc_realtime(RCRealTimeValues* values);
+int8_t sysvar_get_rc_realtime(RCRealTimeValues* values);
+
 #endif  // SYS_VAR_H
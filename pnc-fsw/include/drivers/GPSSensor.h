@@ -19,18 +19,23 @@ struct __attribute__((packed)) GPSSensorData {
   int32_t vel_d_mmps;
   int32_t hacc_mm;
   int32_t vacc_mm;
+  uint32_t itow_ms;  // GPS time of week of the navigation epoch
 
-  static GPSSensorData fromGnss(SFE_UBLOX_GNSS& gnss);
+  static GPSSensorData fromPVT(const UBX_NAV_PVT_data_t& pvt);
 };
 
 /**
  * @brief Implementation of a Sensor for the u-blox GNSS receiver
  *
+ * The receiver pushes a NAV-PVT every epoch at GPS_NAV_RATE_HZ, readToSysVar
+ * only collects what has arrived and publishes it through onPVT.
  */
 class GPSSensor : public Sensor {
  private:
   SFE_UBLOX_GNSS gnss;
 
+  static void onPVT(UBX_NAV_PVT_data_t* pvt);
+
  public:
   GPSSensor();
   bool verify() override;
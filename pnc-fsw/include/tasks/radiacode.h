@@ -0,0 +1,7 @@
+#ifndef RADIACODE_TASK_H
+#define RADIACODE_TASK_H
+
+void radiacode_setup();
+void radiacode_task_init();
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef SENSORS_TASK_H
+#define SENSORS_TASK_H
+
+void sensors_setup();
+void sensors_task_init();
+
+#endif
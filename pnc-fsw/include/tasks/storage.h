@@ -0,0 +1,24 @@
+#ifndef STORAGE_TASK_H
+#define STORAGE_TASK_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Files the storage task writes for this boot, each fed by a single
+ * task
+ *
+ */
+typedef enum : uint8_t {
+  STORAGE_FILE_DATA,  // data<n>.bin, PnC records from the sensors task
+  STORAGE_FILE_RC,    // rc<n>.bin, RadiaCode events
+  STORAGE_FILE_SPEC,  // spec<n>.bin, RadiaCode spectra
+  STORAGE_FILE_COUNT
+} StorageFile;
+
+void storage_setup();
+void storage_task_init();
+
+// write-behind buffered SD writes, never block
+bool storage_write(StorageFile file, const uint8_t* data, size_t len);
+
+#endif
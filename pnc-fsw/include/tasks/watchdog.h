@@ -3,8 +3,10 @@
 
 #include <stdint.h>
 
-#define WATCHDOG_MAIN_TASK_ID 0
+#define WATCHDOG_SENSORS_TASK_ID 0
 #define WATCHDOG_MONITOR_TASK_ID 1
+#define WATCHDOG_STORAGE_TASK_ID 2
+#define WATCHDOG_RADIACODE_TASK_ID 3
 
 void watchdog_task();
 void watchdog_task_init();
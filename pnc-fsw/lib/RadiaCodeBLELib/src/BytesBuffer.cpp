@@ -2,6 +2,8 @@
 
 #include <Arduino.h>  // for print and printAll
 
+#include <algorithm>
+
 #ifndef BytesBuffer_printf
 #define BytesBuffer_printf(...) Serial.printf(__VA_ARGS__)
 #endif
@@ -88,16 +90,47 @@ void BytesBuffer::drain(uint8_t* output, size_t len) {
   }
 }
 
+/**
+ * @brief Views the readable bytes as one contiguous block, unwrapping them in
+ * place first if they cross the end of the buffer
+ *
+ * The view is valid until the buffer is next changed, use drain(nullptr, n)
+ * to consume bytes parsed through it.
+ *
+ * @return ByteSpan The readable bytes
+ */
+ByteSpan BytesBuffer::span() {
+  size_t len = this->size();
+  if (start > end) {
+    // wrapped, rotate so the readable bytes start at data[0]
+    std::rotate(data, data + start, data + capacity);
+    start = 0;
+    end = len;
+  }
+  return ByteSpan{data + start, len};
+}
+
 void BytesBuffer::copy(BytesBuffer& other) {
-  // capacity must be the same for this
-  this->start = other.start;
-  this->end = other.end;
-  memcpy(this->data, other.data, this->capacity);
+  // only the readable bytes, unwrapped to the start of this buffer
+  size_t len = other.size();
+  if (len >= this->capacity) {
+    BytesBuffer_printf("ERROR: Buffer overflow\n");
+    len = this->capacity - 1;
+  }
+  this->start = 0;
+  this->end = len;
+  size_t first_part = other.capacity - other.start;
+  if (first_part >= len) {
+    memcpy(this->data, other.data + other.start, len);
+  } else {
+    memcpy(this->data, other.data + other.start, first_part);
+    memcpy(this->data + first_part, other.data, len - first_part);
+  }
 }
 
 void BytesBuffer::print() {
   BytesBuffer_printf("start: %u end: %u capacity: %u\n", start, end, capacity);
-  int i = start;
+  size_t i = start;
   while (i != end) {
     BytesBuffer_printf("%02x ", this->data[i]);
     i++;
@@ -106,7 +139,7 @@ void BytesBuffer::print() {
 }
 
 void BytesBuffer::printAll() {
-  for (int i = 0; i < capacity; i++) {
+  for (size_t i = 0; i < capacity; i++) {
     BytesBuffer_printf("%02x ", this->data[i]);
   }
 }
\ No newline at end of file
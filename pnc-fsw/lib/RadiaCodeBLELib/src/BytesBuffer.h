@@ -5,6 +5,15 @@
 #include <stdio.h>
 #include <string.h>  // for memcpy and size_t
 
+/**
+ * @brief Read-only view of contiguous bytes
+ *
+ */
+struct ByteSpan {
+  const uint8_t* data;
+  size_t size;
+};
+
 class BytesBuffer {
  private:
   size_t start;
@@ -24,6 +33,7 @@ class BytesBuffer {
   void fill(const uint8_t* new_data, size_t len);
   void copy(BytesBuffer& other);
   void drain(uint8_t* output, size_t len);
+  ByteSpan span();
   void print();
   void printAll();
 
@@ -47,6 +57,30 @@ class BytesBuffer {
       return res;
     }
   }
+
+  /**
+   * @brief Consumes a value only if enough bytes are left
+   *
+   * @return true if out was read, false leaves the buffer untouched
+   */
+  template <typename T>
+  bool try_consume(T& out) {
+    if (size() < sizeof(T)) return false;
+    out = consume<T>();
+    return true;
+  }
+
+  /**
+   * @brief Consumes n values with at most two memcpys
+   *
+   * @return true if all n were read, false leaves the buffer untouched
+   */
+  template <typename T>
+  bool consume_array(T* out, size_t n) {
+    if (size() < n * sizeof(T)) return false;
+    drain((uint8_t*)out, n * sizeof(T));
+    return true;
+  }
 };
 
 #endif
\ No newline at end of file
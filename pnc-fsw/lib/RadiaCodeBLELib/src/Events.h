@@ -3,12 +3,25 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <variant>
 
 typedef uint32_t dt_t;
 
-struct RealTimeData {
+/**
+ * @brief Copies a packed event struct as is, the binary form used in the rc
+ * file
+ *
+ * @return size_t Bytes written to out
+ */
+template <typename T>
+static inline size_t store_fields(const T& fields, uint8_t* out) {
+  memcpy(out, &fields, sizeof(T));
+  return sizeof(T);
+}
+
+struct __attribute__((packed)) RealTimeData {
   dt_t dt;
   float count_rate;
   float dose_rate;
@@ -21,26 +34,20 @@ struct RealTimeData {
     return snprintf(str, len, "Real,%u,%.5f,%u,%.5f,%u,%u,%u", dt, count_rate,
                     count_rate_err, dose_rate, dose_rate_err, flags, rt_flags);
   }
-  int to_store(char* str, size_t len) const {
-    // more known max size
-    return snprintf(str, len, "Real,%x,%x,%x,%x,%x,%x,%x", dt, count_rate,
-                    count_rate_err, dose_rate, dose_rate_err, flags, rt_flags);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
-struct RawData {
+struct __attribute__((packed)) RawData {
   dt_t dt;
   float count_rate;
   float dose_rate;
   int to_string(char* str, size_t len) const {
     return snprintf(str, len, "Raw,%u,%.5f,%.5f", dt, count_rate, dose_rate);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "Raw,%x,%x,%x", dt, count_rate, dose_rate);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
-struct DoseRateDB {
+struct __attribute__((packed)) DoseRateDB {
   dt_t dt;
   uint32_t count;
   float count_rate;
@@ -51,13 +58,10 @@ struct DoseRateDB {
     return snprintf(str, len, "Dose,%u,%u,%.5f,%.5f,%u,%u", dt, count,
                     count_rate, dose_rate, dose_rate_err, flags);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "Dose,%u,%u,%.5f,%.5f,%u,%u", dt, count,
-                    count_rate, dose_rate, dose_rate_err, flags);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
-struct RareData {
+struct __attribute__((packed)) RareData {
   dt_t dt;
   uint32_t duration;
   float dose;
@@ -68,13 +72,10 @@ struct RareData {
     return snprintf(str, len, "Rare,%u,%d,%.5f,%u,%u,%u", dt, duration, dose,
                     temperature, charge_level, flags);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "Rare,%x,%x,%x,%x,%x,%x", dt, duration, dose,
-                    temperature, charge_level, flags);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
-struct Event {
+struct __attribute__((packed)) Event {
   dt_t dt;
   uint8_t event;
   uint8_t event_param1;
@@ -83,61 +84,115 @@ struct Event {
     return snprintf(str, len, "Eve,%u,%u,%u,%u", dt, event, event_param1,
                     flags);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "Eve,%x,%x,%x,%x", dt, event, event_param1,
-                    flags);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
 // less confident in these types:
-struct RawCountRate {
+struct __attribute__((packed)) RawCountRate {
   dt_t dt;
   float count_rate;
   uint16_t flags;
   int to_string(char* str, size_t len) const {
     return snprintf(str, len, "%u,%.5f,%u", dt, count_rate, flags);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "%x,%x,%x", dt, count_rate, flags);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
-struct RawDoseRate {
+struct __attribute__((packed)) RawDoseRate {
   dt_t dt;
   float dose_rate;
   uint16_t flags;
   int to_string(char* str, size_t len) const {
     return snprintf(str, len, "%u,%.5f,%u", dt, dose_rate, flags);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "%x,%x,%x", dt, dose_rate, flags);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 // end
 
 // to be returned for the unknown types
-struct RCNone {
+struct __attribute__((packed)) RCNone {
   uint8_t eid;
   uint8_t gid;
   int to_string(char* str, size_t len) const {
     return snprintf(str, len, "[RCNone %u|%u]", eid, gid);
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "[RCNone %x|%x]", eid, gid);
-  }
+  size_t to_store(uint8_t* out) const { return store_fields(*this, out); }
 };
 
-struct RCError {
+struct __attribute__((packed)) RCError {
   int to_string(char* str, size_t len) const {
     return snprintf(str, len, "[RCError]");
   }
-  int to_store(char* str, size_t len) const {
-    return snprintf(str, len, "[RCError]");
-  }
+  size_t to_store(uint8_t* /*out*/) const { return 0; }
 };
 
 // now combine into variant set
 using DataPoint = std::variant<RealTimeData, RawData, DoseRateDB, RareData,
                                Event, RawDoseRate, RawCountRate, RCError, RCNone>;
 
+/**
+ * @brief Type tag of each record in the binary rc file, the DataPoint
+ * variant index
+ *
+ */
+enum DataPointType : uint8_t {
+  DP_REAL_TIME_DATA = 0,
+  DP_RAW_DATA,
+  DP_DOSE_RATE_DB,
+  DP_RARE_DATA,
+  DP_EVENT,
+  DP_RAW_DOSE_RATE,
+  DP_RAW_COUNT_RATE,
+  DP_RC_ERROR,
+  DP_RC_NONE
+};
+static_assert(std::variant_size_v<DataPoint> == DP_RC_NONE + 1,
+              "DataPointType must match the DataPoint alternatives");
+
+/** @brief High nibble of every record tag, the low nibble is the type */
+#define DATA_POINT_RECORD_MARK 0xA0
+
+/**
+ * @brief Start of a binary rc file record, followed by length bytes of the
+ * packed event struct and an int8_t sum complement checksum over the record
+ *
+ */
+struct __attribute__((packed)) DataPointRecordHeader {
+  uint8_t tag;     // DATA_POINT_RECORD_MARK | DataPointType
+  uint8_t length;  // event struct bytes
+  uint32_t millis;
+};
+
+/** @brief Largest record data_point_to_record can write */
+#define DATA_POINT_RECORD_MAX_SIZE \
+  (sizeof(DataPointRecordHeader) + sizeof(DataPoint) + sizeof(int8_t))
+
+/**
+ * @brief Writes a DataPoint as a binary rc file record
+ *
+ * @param d Event to store
+ * @param millis Time the event was read from the RadiaCode
+ * @param out Buffer of at least DATA_POINT_RECORD_MAX_SIZE bytes
+ * @return size_t Bytes written, 0 for events not worth storing
+ */
+static inline size_t data_point_to_record(const DataPoint& d, uint32_t millis,
+                                          uint8_t* out) {
+  uint8_t* fields = out + sizeof(DataPointRecordHeader);
+  size_t length =
+      std::visit([fields](const auto& v) { return v.to_store(fields); }, d);
+  if (length == 0) return 0;
+
+  DataPointRecordHeader header;
+  header.tag = DATA_POINT_RECORD_MARK | d.index();
+  header.length = length;
+  header.millis = millis;
+  memcpy(out, &header, sizeof(header));
+
+  size_t record_len = sizeof(header) + length;
+  int8_t sum = 0;
+  for (size_t i = 0; i < record_len; i++) sum += out[i];
+  out[record_len] = -sum;
+  return record_len + sizeof(int8_t);
+}
+
 #endif
\ No newline at end of file
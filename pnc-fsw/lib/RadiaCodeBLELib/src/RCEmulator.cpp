@@ -0,0 +1,448 @@
+#include "RCEmulator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// length prefix, then req_type, zero and req_seq_no
+#define FRAME_HEADER_SIZE 8
+
+// DATA_BUF gid of each DataPoint alternative, -1 for those never sent
+static const int8_t DATA_BUF_GID[] = {0, 1, 2, 3, 7, 9, 8, -1, -1};
+static_assert(sizeof(DATA_BUF_GID) == std::variant_size_v<DataPoint>,
+              "DATA_BUF_GID must cover every DataPoint alternative");
+
+template <typename T>
+static void append(uint8_t*& pos, T value) {
+  memcpy(pos, &value, sizeof(T));
+  pos += sizeof(T);
+}
+
+/**
+ * @brief Construct a new RCEmulator object, connected with nothing queued
+ *
+ * @param receive Where responses are delivered, rc_transport_receive unless
+ * the emulator is used on its own
+ */
+RCEmulator::RCEmulator(void (*receive)(const uint8_t* data, size_t len)) {
+  this->receive = receive;
+  this->link_up = true;
+  this->notify_size = 20;  // the RadiaCode's notifications at the default MTU
+  this->fault = RC_EMULATOR_FAULT_NONE;
+  this->fault_every = 0;
+  this->reset();
+}
+
+bool RCEmulator::connected() { return this->link_up; }
+
+/**
+ * @brief Reassembles requests and answers each once complete, a write can
+ * end one request and start the next
+ *
+ */
+void RCEmulator::write(const uint8_t* data, size_t len) {
+  if (this->request_len + len > sizeof(this->request)) {
+    // not a request the RadiaCode would take, resync on the next one
+    this->request_len = 0;
+    return;
+  }
+  memcpy(this->request + this->request_len, data, len);
+  this->request_len += len;
+
+  while (this->request_len >= FRAME_HEADER_SIZE) {
+    uint32_t length;
+    memcpy(&length, this->request, sizeof(length));
+    size_t frame_len = sizeof(length) + length;
+    if (frame_len < FRAME_HEADER_SIZE) {
+      this->request_len = 0;  // resync as on an oversized request
+      return;
+    }
+    if (this->request_len < frame_len) return;
+
+    this->handle_request(frame_len);
+    this->request_len -= frame_len;
+    memmove(this->request, this->request + frame_len, this->request_len);
+  }
+}
+
+/**
+ * @brief Simulates the link dropping, requests fail until reconnected
+ *
+ */
+void RCEmulator::set_connected(bool connected) { this->link_up = connected; }
+
+/**
+ * @brief Sets the bytes per notification, 1 splits even the length prefix
+ *
+ */
+void RCEmulator::set_notify_size(size_t bytes) {
+  this->notify_size = bytes > 0 ? bytes : 1;
+}
+
+/**
+ * @brief Injects a fault into every nth response
+ *
+ * @param every 0 turns faults off
+ */
+void RCEmulator::set_fault(RCEmulatorFault fault, uint32_t every) {
+  this->fault = fault;
+  this->fault_every = every;
+}
+
+/**
+ * @brief Adds an event to the next DATA_BUF response
+ *
+ * @return false for RCNone/RCError or when the DATA_BUF is full
+ */
+bool RCEmulator::queue_event(const DataPoint& d) {
+  int8_t gid = DATA_BUF_GID[d.index()];
+  if (gid < 0) return false;
+
+  // DATA_BUF carries the packed fields in the same order, with a 10 ms tick
+  // offset in place of dt
+  uint8_t fields[sizeof(DataPoint)];
+  size_t len =
+      std::visit([&fields](const auto& v) { return v.to_store(fields); }, d);
+  dt_t dt;
+  memcpy(&dt, fields, sizeof(dt));
+
+  size_t record = 3 + sizeof(int32_t) + len - sizeof(dt_t);
+  if (this->data_buf_len + record > sizeof(this->data_buf)) return false;
+
+  uint8_t* pos = this->data_buf + this->data_buf_len;
+  append<uint8_t>(pos, this->data_buf_seq++);
+  append<uint8_t>(pos, 0);  // eid
+  append<uint8_t>(pos, gid);
+  append<int32_t>(pos, dt / 10);
+  memcpy(pos, fields + sizeof(dt_t), len - sizeof(dt_t));
+  this->data_buf_len += record;
+  return true;
+}
+
+/**
+ * @brief Adds raw DATA_BUF records to the next DATA_BUF response
+ *
+ * @return false when the DATA_BUF is full
+ */
+bool RCEmulator::queue_data_buf(const uint8_t* bytes, size_t len) {
+  if (this->data_buf_len + len > sizeof(this->data_buf)) return false;
+  memcpy(this->data_buf + this->data_buf_len, bytes, len);
+  this->data_buf_len += len;
+  return true;
+}
+
+/**
+ * @brief Sets the spectrum the device has accumulated
+ *
+ * @param counts Counts per channel, channels past the end are zero
+ */
+void RCEmulator::set_spectrum(const int* counts, size_t channels, uint32_t ts,
+                              float a0, float a1, float a2) {
+  if (channels > RC_SPECTRUM_CHANNELS) channels = RC_SPECTRUM_CHANNELS;
+  memcpy(this->spectrum, counts, channels * sizeof(int));
+  memset(this->spectrum + channels, 0,
+         (RC_SPECTRUM_CHANNELS - channels) * sizeof(int));
+  this->spectrum_ts = ts;
+  this->a0 = a0;
+  this->a1 = a1;
+  this->a2 = a2;
+}
+
+/**
+ * @brief Sets the raw value a RD_VIRT_SFR_BATCH returns for a VSFR, the rest
+ * read as invalid
+ *
+ * @return false when RC_EMULATOR_MAX_VSFRS are already set
+ */
+bool RCEmulator::set_vsfr(uint32_t id, uint32_t value) {
+  for (uint8_t i = 0; i < this->vsfr_count; i++) {
+    if (this->vsfr_ids[i] == id) {
+      this->vsfr_values[i] = value;
+      return true;
+    }
+  }
+  if (this->vsfr_count >= RC_EMULATOR_MAX_VSFRS) return false;
+  this->vsfr_ids[this->vsfr_count] = id;
+  this->vsfr_values[this->vsfr_count] = value;
+  this->vsfr_count++;
+  return true;
+}
+
+/**
+ * @brief Queues one line of the text rc log, an event ("Real,...",
+ * optionally after the millis) or a spectrum ("a0: ..." then "Spectrum: ...")
+ *
+ * @return true if the line was understood
+ */
+bool RCEmulator::replay_line(const char* line) {
+  // skip the millis the task logged the line at
+  const char* p = line;
+  while (*p >= '0' && *p <= '9') p++;
+  p = (p != line && *p == ',') ? p + 1 : line;
+
+  unsigned dt, count, duration;
+  unsigned short count_rate_err, dose_rate_err, flags, temperature,
+      charge_level;
+  unsigned char rt_flags, event, event_param1;
+  float count_rate, dose_rate, dose;
+
+  if (sscanf(p, "Real,%u,%f,%hu,%f,%hu,%hu,%hhu", &dt, &count_rate,
+             &count_rate_err, &dose_rate, &dose_rate_err, &flags,
+             &rt_flags) == 7) {
+    return this->queue_event(RealTimeData{dt, count_rate, dose_rate,
+                                          count_rate_err, dose_rate_err,
+                                          flags, rt_flags});
+  }
+  if (sscanf(p, "Raw,%u,%f,%f", &dt, &count_rate, &dose_rate) == 3) {
+    return this->queue_event(RawData{dt, count_rate, dose_rate});
+  }
+  if (sscanf(p, "Dose,%u,%u,%f,%f,%hu,%hu", &dt, &count, &count_rate,
+             &dose_rate, &dose_rate_err, &flags) == 6) {
+    return this->queue_event(
+        DoseRateDB{dt, count, count_rate, dose_rate, dose_rate_err, flags});
+  }
+  if (sscanf(p, "Rare,%u,%u,%f,%hu,%hu,%hu", &dt, &duration, &dose,
+             &temperature, &charge_level, &flags) == 6) {
+    return this->queue_event(
+        RareData{dt, duration, dose, temperature, charge_level, flags});
+  }
+  if (sscanf(p, "Eve,%u,%hhu,%hhu,%hu", &dt, &event, &event_param1,
+             &flags) == 4) {
+    return this->queue_event(Event{dt, event, event_param1, flags});
+  }
+
+  float a0, a1, a2;
+  unsigned ts;
+  if (sscanf(p, "a0: %f, a1: %f, a2: %f, ts: %u", &a0, &a1, &a2, &ts) == 4) {
+    // the counts follow on the next line
+    this->spectrum_ts = ts;
+    this->a0 = a0;
+    this->a1 = a1;
+    this->a2 = a2;
+    return true;
+  }
+  if (strncmp(p, "Spectrum:", 9) == 0) {
+    p += 9;
+    size_t channels = 0;
+    while (channels < RC_SPECTRUM_CHANNELS) {
+      char* end;
+      long v = strtol(p, &end, 10);
+      if (end == p) break;
+      this->spectrum[channels++] = v;
+      p = end;
+      while (*p == ',' || *p == ' ') p++;
+    }
+    memset(this->spectrum + channels, 0,
+           (RC_SPECTRUM_CHANNELS - channels) * sizeof(int));
+    return channels > 0;
+  }
+
+  // RawCountRate/RawDoseRate lines have no prefix, RCNone/RCError carry
+  // nothing to send
+  return false;
+}
+
+/**
+ * @brief Clears every queued event, the spectrum, the VSFRs and the
+ * counters
+ *
+ */
+void RCEmulator::reset() {
+  this->request_len = 0;
+  this->data_buf_len = 0;
+  this->data_buf_seq = 0;
+  memset(this->spectrum, 0, sizeof(this->spectrum));
+  memset(this->diff_base, 0, sizeof(this->diff_base));
+  this->spectrum_ts = 0;
+  this->a0 = 0;
+  this->a1 = 0;
+  this->a2 = 0;
+  this->vsfr_count = 0;
+  this->request_count = 0;
+  this->fault_count = 0;
+}
+
+/**
+ * @brief Answers the complete request at the start of request
+ *
+ * @param frame_len Bytes of request it takes up
+ */
+void RCEmulator::handle_request(size_t frame_len) {
+  uint16_t req_type;
+  memcpy(&req_type, this->request + 4, sizeof(req_type));
+  uint8_t req_seq_no = this->request[7];
+  const uint8_t* args = this->request + FRAME_HEADER_SIZE;
+  size_t args_len = frame_len - FRAME_HEADER_SIZE;
+
+  uint8_t* payload = this->response + FRAME_HEADER_SIZE;
+  uint8_t* pos = payload;
+  switch (req_type) {
+    case Command::WR_VIRT_SFR:
+      append<uint32_t>(pos, 1);  // retcode
+      break;
+
+    case Command::RD_VIRT_SFR_BATCH: {
+      // count then ids, answered with a validity bit then a value per id
+      uint32_t n = 0;
+      if (args_len >= sizeof(n)) memcpy(&n, args, sizeof(n));
+      if (n > 32 || args_len < (1 + n) * sizeof(uint32_t)) n = 0;
+      uint32_t valid = 0;
+      uint8_t* values = pos + sizeof(valid);
+      for (uint32_t i = 0; i < n; i++) {
+        uint32_t id;
+        memcpy(&id, args + (1 + i) * sizeof(uint32_t), sizeof(id));
+        uint32_t value = 0;
+        for (uint8_t j = 0; j < this->vsfr_count; j++) {
+          if (this->vsfr_ids[j] == id) {
+            value = this->vsfr_values[j];
+            valid |= 1UL << i;
+          }
+        }
+        memcpy(values + i * sizeof(value), &value, sizeof(value));
+      }
+      append<uint32_t>(pos, valid);
+      pos += n * sizeof(uint32_t);
+      break;
+    }
+
+    case Command::RD_VIRT_STRING: {
+      uint32_t id = 0;
+      if (args_len >= sizeof(id)) memcpy(&id, args, sizeof(id));
+      // retcode and flen, then the string
+      size_t flen = 0;
+      bool ok = this->read_virt_string(
+          id, payload + 8, sizeof(this->response) - FRAME_HEADER_SIZE - 8,
+          flen);
+      append<uint32_t>(pos, ok ? 1 : 0);
+      append<uint32_t>(pos, flen);
+      pos += flen;
+      break;
+    }
+
+    default:
+      // SET_EXCHANGE and the rest are acknowledged with just the header
+      break;
+  }
+
+  this->respond(req_type, req_seq_no, pos - payload);
+}
+
+/**
+ * @brief Builds a RD_VIRT_STRING response
+ *
+ * @param len Bytes written to out
+ * @return false for unknown ids and spectra that don't fit
+ */
+bool RCEmulator::read_virt_string(uint32_t id, uint8_t* out, size_t capacity,
+                                  size_t& len) {
+  len = 0;
+  switch (id) {
+    case VS::DATA_BUF:
+      len = this->data_buf_len < capacity ? this->data_buf_len : capacity;
+      memcpy(out, this->data_buf, len);
+      this->data_buf_len = 0;
+      return true;
+
+    case VS::SPECTRUM:
+      len = encode_spectrum(this->spectrum, RC_SPECTRUM_CHANNELS,
+                            this->spectrum_ts, this->a0, this->a1, this->a2,
+                            out, capacity);
+      return len > 0;
+
+    case VS::SPEC_DIFF:
+      // counts since the last SPEC_DIFF, built in diff_base then replaced
+      for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) {
+        this->diff_base[i] = this->spectrum[i] - this->diff_base[i];
+      }
+      len = encode_spectrum(this->diff_base, RC_SPECTRUM_CHANNELS,
+                            this->spectrum_ts, this->a0, this->a1, this->a2,
+                            out, capacity);
+      memcpy(this->diff_base, this->spectrum, sizeof(this->spectrum));
+      return len > 0;
+  }
+  return false;
+}
+
+/**
+ * @brief Frames the payload already in response and delivers it in
+ * notify_size pieces, unless a fault is due
+ *
+ */
+void RCEmulator::respond(uint16_t req_type, uint8_t req_seq_no,
+                         size_t payload_len) {
+  this->request_count++;
+  bool faulty = this->fault != RC_EMULATOR_FAULT_NONE &&
+                this->fault_every > 0 &&
+                this->request_count % this->fault_every == 0;
+  if (faulty) {
+    this->fault_count++;
+    if (this->fault == RC_EMULATOR_FAULT_DROP) return;
+    if (this->fault == RC_EMULATOR_FAULT_BAD_HEADER) req_type ^= 0xFFFF;
+  }
+
+  uint8_t* pos = this->response;
+  append<uint32_t>(pos, FRAME_HEADER_SIZE - 4 + payload_len);
+  append<uint16_t>(pos, req_type);
+  append<uint8_t>(pos, 0);
+  append<uint8_t>(pos, req_seq_no);
+
+  size_t total = FRAME_HEADER_SIZE + payload_len;
+  for (size_t i = 0; i < total; i += this->notify_size) {
+    size_t n = total - i < this->notify_size ? total - i : this->notify_size;
+    this->receive(this->response + i, n);
+  }
+}
+
+/**
+ * @brief Encodes a spectrum in the RadiaCode run-length/delta format that
+ * decode_spectrum reads
+ *
+ * @param counts Counts per channel
+ * @param out Output bytes
+ * @param capacity Size of out
+ * @return size_t Number of bytes written, 0 if it did not fit
+ */
+size_t RCEmulator::encode_spectrum(const int* counts, size_t channels,
+                                   uint32_t ts, float a0, float a1, float a2,
+                                   uint8_t* out, size_t capacity) {
+  if (capacity < 16) return 0;
+  uint8_t* pos = out;
+  uint8_t* end = out + capacity;
+  append<uint32_t>(pos, ts);
+  append<float>(pos, a0);
+  append<float>(pos, a1);
+  append<float>(pos, a2);
+
+  // pick the encoding of a channel, runs are extended while it matches
+  auto vlen_of = [counts](size_t at, int prev) -> uint16_t {
+    int d = counts[at] - prev;
+    if (counts[at] == 0) return 0;
+    if (d >= INT8_MIN && d <= INT8_MAX) return 2;
+    if (d >= INT16_MIN && d <= INT16_MAX) return 3;
+    return 5;
+  };
+
+  int last = 0;
+  size_t i = 0;
+  while (i < channels) {
+    uint16_t vlen = vlen_of(i, last);
+    if (end - pos < 2) return 0;
+    uint8_t* header = pos;
+    pos += sizeof(uint16_t);
+    uint16_t cnt = 0;
+    while (i < channels && cnt < 0x0FFF && vlen_of(i, last) == vlen) {
+      if (end - pos < 4) return 0;
+      int d = counts[i] - last;
+      if (vlen == 2) append<int8_t>(pos, d);
+      if (vlen == 3) append<int16_t>(pos, d);
+      if (vlen == 5) append<int32_t>(pos, d);
+      last = counts[i];
+      cnt++;
+      i++;
+    }
+    uint16_t u16 = (cnt << 4) | vlen;
+    memcpy(header, &u16, sizeof(u16));
+  }
+
+  return pos - out;
+}
@@ -0,0 +1,104 @@
+#ifndef RC_EMULATOR_H
+#define RC_EMULATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Events.h"
+#include "RCProtocol.h"
+#include "RCTransport.h"
+
+/** @brief Largest request frame the emulator accepts */
+#define RC_EMULATOR_MAX_REQUEST 256
+
+/** @brief Largest response frame, length prefix included, kept under the
+ * 4000 byte response buffers */
+#define RC_EMULATOR_MAX_RESPONSE 3900
+
+/** @brief Queued DATA_BUF bytes, events past this are dropped */
+#define RC_EMULATOR_DATA_BUF_SIZE 2048
+
+/** @brief VSFRs that can be given values with set_vsfr */
+#define RC_EMULATOR_MAX_VSFRS 16
+
+/**
+ * @brief Fault injected into every nth response
+ *
+ */
+typedef enum : uint8_t {
+  RC_EMULATOR_FAULT_NONE,
+  RC_EMULATOR_FAULT_DROP,       // no response, the request times out
+  RC_EMULATOR_FAULT_BAD_HEADER  // response with the wrong req_type
+} RCEmulatorFault;
+
+/**
+ * @brief Stands in for a RadiaCode behind rc_set_transport, answering
+ * SET_EXCHANGE, WR_VIRT_SFR, RD_VIRT_SFR_BATCH and RD_VIRT_STRING for
+ * DATA_BUF, SPECTRUM and SPEC_DIFF in the device's framing
+ *
+ * Responses are delivered from inside write, split into notifications of
+ * set_notify_size bytes. Events and spectra are queued directly or replayed
+ * from the text rc log lines. Only needs the C library, so it also builds
+ * off target.
+ */
+class RCEmulator : public RCTransport {
+ private:
+  void (*receive)(const uint8_t* data, size_t len);
+  bool link_up;
+  size_t notify_size;
+  RCEmulatorFault fault;
+  uint32_t fault_every;
+
+  uint8_t request[RC_EMULATOR_MAX_REQUEST];
+  size_t request_len;
+  uint8_t response[RC_EMULATOR_MAX_RESPONSE];
+
+  uint8_t data_buf[RC_EMULATOR_DATA_BUF_SIZE];
+  size_t data_buf_len;
+  uint8_t data_buf_seq;
+
+  int spectrum[RC_SPECTRUM_CHANNELS];
+  int diff_base[RC_SPECTRUM_CHANNELS];  // spectrum at the last SPEC_DIFF
+  uint32_t spectrum_ts;
+  float a0, a1, a2;
+
+  uint32_t vsfr_ids[RC_EMULATOR_MAX_VSFRS];
+  uint32_t vsfr_values[RC_EMULATOR_MAX_VSFRS];
+  uint8_t vsfr_count;
+
+  uint32_t request_count;
+  uint32_t fault_count;
+
+  void handle_request(size_t frame_len);
+  void respond(uint16_t req_type, uint8_t req_seq_no, size_t payload_len);
+  bool read_virt_string(uint32_t id, uint8_t* out, size_t capacity,
+                        size_t& len);
+
+ public:
+  RCEmulator(void (*receive)(const uint8_t* data,
+                             size_t len) = rc_transport_receive);
+
+  bool connected() override;
+  void write(const uint8_t* data, size_t len) override;
+
+  void set_connected(bool connected);
+  void set_notify_size(size_t bytes);
+  void set_fault(RCEmulatorFault fault, uint32_t every);
+
+  bool queue_event(const DataPoint& d);
+  bool queue_data_buf(const uint8_t* bytes, size_t len);
+  void set_spectrum(const int* counts, size_t channels, uint32_t ts,
+                    float a0, float a1, float a2);
+  bool set_vsfr(uint32_t id, uint32_t value);
+  bool replay_line(const char* line);
+  void reset();
+
+  uint32_t requests() const { return request_count; }
+  uint32_t faults() const { return fault_count; }
+
+  static size_t encode_spectrum(const int* counts, size_t channels,
+                                uint32_t ts, float a0, float a1, float a2,
+                                uint8_t* out, size_t capacity);
+};
+
+#endif
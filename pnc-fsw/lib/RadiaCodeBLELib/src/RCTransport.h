@@ -0,0 +1,35 @@
+#ifndef RC_TRANSPORT_H
+#define RC_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Byte link the RadiaCode requests go over, BLE unless replaced with
+ * rc_set_transport
+ *
+ * Responses come back through rc_transport_receive in any split, from any
+ * context, including from inside write.
+ */
+class RCTransport {
+ public:
+  virtual ~RCTransport() {}
+
+  /**
+   * @brief Get if requests can be written
+   *
+   */
+  virtual bool connected() = 0;
+
+  /**
+   * @brief Sends one chunk of a framed request, at most rc_ble_chunk_size
+   * bytes
+   *
+   */
+  virtual void write(const uint8_t* data, size_t len) = 0;
+};
+
+void rc_set_transport(RCTransport* transport);
+void rc_transport_receive(const uint8_t* data, size_t len);
+
+#endif
@@ -1,6 +1,8 @@
 #include "RadiacodeBLE.h"
 
 #include <BLE.h>
+#include <btstack.h>
+#include <pico/cyw43_arch.h>
 
 // use this to print if 
 #ifndef RC_BLE_DEBUG 
@@ -15,7 +17,16 @@
 #define always_printf(...) Serial.printf(__VA_ARGS__)
 #endif 
 
+#include <atomic>
+
+#ifdef __FREERTOS
+#include <FreeRTOS.h>
+#include <semphr.h>
+#endif
+
+#ifndef BLE_RESPONSE_TIMEOUT
 #define BLE_RESPONSE_TIMEOUT 10000
+#endif
 
 #define RADIACODE_SERVICE_UUID "e63215e5-7003-49d8-96b0-b024798fb901"
 #define RADIACODE_WRITE_FD_UUID "e63215e6-7003-49d8-96b0-b024798fb901"
@@ -25,85 +36,411 @@ static BLEUUID rc_service_uuid(RADIACODE_SERVICE_UUID);
 static BLEUUID rc_write_uuid(RADIACODE_WRITE_FD_UUID);
 static BLEUUID rc_notify_uuid(RADIACODE_NOTIFY_FD_UUID);
 
+// RADIACODE_WRITE_FD_UUID in the big endian order BTstack takes
+static const uint8_t rc_write_uuid128[16] = {0xe6, 0x32, 0x15, 0xe6,
+                                             0x70, 0x03, 0x49, 0xd8,
+                                             0x96, 0xb0, 0xb0, 0x24,
+                                             0x79, 0x8f, 0xb9, 0x01};
+
 static BLERemoteCharacteristic* rc_write_char;
 static BLERemoteCharacteristic* rc_notify_char;
 
-#define BLE_BUFFER_SIZE 4000
-static BytesBuffer _resp_buffer(BLE_BUFFER_SIZE);
-static BytesBuffer _response(BLE_BUFFER_SIZE);
-static mutex_t _response_mutex;
-static volatile bool _response_ready = false;
-static BytesBuffer res_ret(BLE_BUFFER_SIZE);
-
-static size_t _resp_size = 0;
-static void notify(BLERemoteCharacteristic* c, const uint8_t* data,
-                   uint32_t len) {
-  // if(c == rc_notify_char){
-  //   Serial.println("rc_notify_char notify");
-  //   for(int i = 0; i < len; i++){
-  //     debug_printf("%02x ", data[i]);
-  //   }
-  //   Serial.println();
-  // }
-
-  // if(c == rc_write_char){
-  //   Serial.println("rc_write_char notify");
-  // }
-
-  if (_resp_size == 0) {
-    // read first 4 bytes as signed integer
-    int size_buf;
-    memcpy(&size_buf, data, sizeof(int));
-    _resp_size = 4 + size_buf;
-    // read in the rest of the bytes as data
-    _resp_buffer.clear();
-    _resp_buffer.fill(data + 4, len - 4);
-  } else {
-    // read in the bytes as data
-    _resp_buffer.fill(data, len);
+// the BLE client doesn't expose the BTstack link, so its handle is kept from
+// the HCI events for the MTU and write without response
+static btstack_packet_callback_registration_t _hci_registration;
+static std::atomic<hci_con_handle_t> _con_handle{HCI_CON_HANDLE_INVALID};
+static gatt_client_characteristic_t _write_characteristic;
+static std::atomic<bool> _write_without_response{false};
+static volatile bool _write_query_found;
+static volatile bool _write_query_done;
+
+/**
+ * @brief Tracks the handle of the LE link, runs in the BTstack context
+ *
+ */
+static void hci_event(uint8_t packet_type, uint16_t /*channel*/,
+                      uint8_t* packet, uint16_t /*size*/) {
+  if (packet_type != HCI_EVENT_PACKET) return;
+  switch (hci_event_packet_get_type(packet)) {
+    case HCI_EVENT_LE_META:
+      if (hci_event_le_meta_get_subevent_code(packet) ==
+              HCI_SUBEVENT_LE_CONNECTION_COMPLETE &&
+          hci_subevent_le_connection_complete_get_status(packet) == 0) {
+        _con_handle =
+            hci_subevent_le_connection_complete_get_connection_handle(packet);
+      }
+      break;
+    case HCI_EVENT_DISCONNECTION_COMPLETE:
+      if (hci_event_disconnection_complete_get_connection_handle(packet) ==
+          _con_handle) {
+        _write_without_response = false;
+        _con_handle = HCI_CON_HANDLE_INVALID;
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Collects the write characteristic's properties and value handle,
+ * runs in the BTstack context
+ *
+ */
+static void write_query_event(uint8_t packet_type, uint16_t /*channel*/,
+                              uint8_t* packet, uint16_t /*size*/) {
+  if (packet_type != HCI_EVENT_PACKET) return;
+  switch (hci_event_packet_get_type(packet)) {
+    case GATT_EVENT_CHARACTERISTIC_QUERY_RESULT:
+      gatt_event_characteristic_query_result_get_characteristic(
+          packet, &_write_characteristic);
+      _write_query_found = true;
+      break;
+    case GATT_EVENT_QUERY_COMPLETE:
+      _write_query_done = true;
+      break;
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Writes a chunk without waiting for the RadiaCode to acknowledge it,
+ * retrying while BTstack has no buffer free
+ *
+ * @return false if the write could not be queued
+ */
+static bool write_without_response(const uint8_t* data, size_t len) {
+  async_context_t* context = cyw43_arch_async_context();
+  uint32_t start = millis();
+  while (millis() - start < BLE_RESPONSE_TIMEOUT) {
+    async_context_acquire_lock_blocking(context);
+    uint8_t err = gatt_client_write_value_of_characteristic_without_response(
+        _con_handle, _write_characteristic.value_handle, len,
+        (uint8_t*)data);
+    async_context_release_lock(context);
+    if (err == ERROR_CODE_SUCCESS) return true;
+    if (err != GATT_CLIENT_BUSY && err != BTSTACK_ACL_BUFFERS_FULL) {
+      return false;
+    }
+    delay(1);
+  }
+  return false;
+}
+
+/**
+ * @brief Default transport, writes to the RadiaCode write characteristic
+ * without response when it allows it
+ *
+ */
+class BLETransport : public RCTransport {
+ public:
+  bool connected() override {
+    return rc_write_char != nullptr && BLE.client() != nullptr &&
+           BLE.client()->connected();
+  }
+  void write(const uint8_t* data, size_t len) override {
+    if (_write_without_response && write_without_response(data, len)) return;
+    rc_write_char->setValue(data, len);
   }
+};
+
+static BLETransport _ble_transport;
+static RCTransport* _transport = &_ble_transport;
 
-  // reduce size
-  _resp_size -= len;
+#define BLE_BUFFER_SIZE 4000
 
-  if (_resp_size == 0) {
-    // copied entire message
-    // Serial.println("message ended");
-    // send to _response
-    mutex_enter_blocking(&_response_mutex);
-    _response.copy(_resp_buffer);
-    mutex_exit(&_response_mutex);
-    _response_ready = true;
+// responses are handed between notify, the request slots and res_ret by
+// pointer, each buffer is only written once by notify. Free buffers go back
+// to notify through a single producer single consumer ring, the producers
+// are the tasks one at a time under _pending_mutex, the consumer is notify.
+#define FREE_RING_SIZE (RC_BUFFER_POOL_SIZE + 1)
+static BytesBuffer* _free_ring[FREE_RING_SIZE];
+static std::atomic<uint8_t> _free_head{0};  // next slot pool_give writes
+static std::atomic<uint8_t> _free_tail{0};  // next slot pool_take reads
+static BytesBuffer* _resp_buffer = nullptr;  // being reassembled by notify
+static BytesBuffer* res_ret = nullptr;       // last blocking response
+static uint32_t _resp_notifications = 0;     // making up the current message
+
+enum RequestState : uint8_t {
+  REQUEST_FREE,
+  REQUEST_PENDING,
+  REQUEST_CLAIMED,  // notify matched it and is handing over the response
+  REQUEST_DONE,
+  REQUEST_FAILED  // timed out or the response header did not match
+};
 
-    // wipe _resp_buffer
-    _resp_buffer.clear();
+/**
+ * @brief One in flight request, matched to its response by req_seq_no
+ *
+ * The fields are written by the requesting task before state is published
+ * as PENDING and read by notify after it sees PENDING. state holds the
+ * req_seq_no next to the RequestState, so a response matched to a slot that
+ * was meanwhile released and reused can't complete the new request.
+ */
+struct PendingRequest {
+  std::atomic<uint16_t> state;  // req_seq_no << 8 | RequestState
+  uint16_t req_type;
+  uint8_t req_seq_no;
+  uint32_t sent_time;
+  uint32_t sent_us;  // for the round trip time
+  rc_request_callback callback;
+  void* ctx;
+  BytesBuffer* response;  // written by notify before state becomes DONE
+#ifdef __FREERTOS
+  SemaphoreHandle_t done;
+#endif
+};
+
+static inline uint16_t slot_state(uint8_t req_seq_no, RequestState state) {
+  return (req_seq_no << 8) | state;
+}
+
+static inline RequestState state_of(uint16_t state) {
+  return (RequestState)(state & 0xFF);
+}
+
+static inline bool state_waiting(uint16_t state) {
+  return state_of(state) == REQUEST_PENDING ||
+         state_of(state) == REQUEST_CLAIMED;
+}
+
+/**
+ * @brief Link statistics, counted from notify and the tasks without a lock.
+ * rtt_total_us wraps after 71 minutes of summed round trips, so read it with
+ * reset more often than that
+ *
+ */
+struct AtomicBleStats {
+  std::atomic<uint32_t> requests;
+  std::atomic<uint32_t> failures;
+  std::atomic<uint32_t> rtt_total_us;
+  std::atomic<uint32_t> rtt_max_us;
+  std::atomic<uint32_t> bytes_sent;
+  std::atomic<uint32_t> writes;
+  std::atomic<uint32_t> bytes_received;
+  std::atomic<uint32_t> notifications;
+};
+
+// busy waits on a response being handed over before sleeping a millisecond
+#define RC_RELEASE_SPINS 64
+
+static PendingRequest _pending[RC_MAX_PENDING];
+// serialises the tasks claiming slots and returning buffers, never taken by
+// notify
+static mutex_t _pending_mutex;
+static mutex_t _write_mutex;  // keeps request chunks from interleaving
+
+static uint16_t _chunk_size = RC_BLE_MTU - 3;  // ATT write header is 3 bytes
+static AtomicBleStats _stats;
+
+/**
+ * @brief Takes a free buffer, only called from notify
+ *
+ * @return BytesBuffer* Empty buffer, nullptr if every buffer is in use
+ */
+static BytesBuffer* pool_take() {
+  uint8_t tail = _free_tail.load(std::memory_order_relaxed);
+  if (tail == _free_head.load(std::memory_order_acquire)) return nullptr;
+  BytesBuffer* b = _free_ring[tail];
+  _free_tail.store((tail + 1) % FREE_RING_SIZE, std::memory_order_release);
+  b->clear();
+  return b;
+}
+
+/**
+ * @brief Returns a buffer to notify, called with _pending_mutex held
+ *
+ */
+static void pool_give(BytesBuffer* b) {
+  if (b == nullptr) return;
+  // never full, the ring has a slot more than there are buffers
+  uint8_t head = _free_head.load(std::memory_order_relaxed);
+  _free_ring[head] = b;
+  _free_head.store((head + 1) % FREE_RING_SIZE, std::memory_order_release);
+}
+
+/**
+ * @brief Wakes whoever is waiting on a finished request
+ *
+ */
+static void request_complete(int handle) {
+  PendingRequest& p = _pending[handle];
+#ifdef __FREERTOS
+  xSemaphoreGive(p.done);
+#endif
+  if (p.callback != nullptr) {
+    uint16_t state = p.state.load(std::memory_order_acquire);
+    p.callback(handle,
+               state_of(state) == REQUEST_DONE ? p.response : nullptr,
+               p.ctx);
   }
 }
 
-static BytesBuffer* ble_execute(uint8_t* data, size_t len) {
-  for (int i = 0; i < len; i += 18) {
-    // write write_fd
-    size_t chunk_size = (len - i > 18) ? 18 : (len - i); 
-    rc_write_char->setValue(data + i, chunk_size);
+/**
+ * @brief Hands the reassembled response in _resp_buffer to the request with
+ * the same req_seq_no and gives notify a fresh buffer, without blocking
+ *
+ */
+static void route_response() {
+  BytesBuffer& response = *_resp_buffer;
+  if (response.size() < 4) {
+    debug_printf("Response too short for a header\n");
+    return;
   }
 
-  uint32_t start_time = millis();
-  while (_response_ready == false) {
-    if (millis() - start_time > BLE_RESPONSE_TIMEOUT) {
-      Serial.println("timeout");
-      return nullptr;
+  uint16_t received_req_type = response.at(0) | (response.at(1) << 8);
+  uint8_t received_zero = response.at(2);
+  uint8_t received_req_seq_no = response.at(3);
+
+  // claim the slot, a timeout or release racing with this wins or loses the
+  // same compare exchange
+  uint16_t pending = slot_state(received_req_seq_no, REQUEST_PENDING);
+  int handle = -1;
+  for (int i = 0; i < RC_MAX_PENDING; i++) {
+    uint16_t expected = pending;
+    if (_pending[i].state.compare_exchange_strong(
+            expected, slot_state(received_req_seq_no, REQUEST_CLAIMED),
+            std::memory_order_acquire)) {
+      handle = i;
+      break;
     }
   }
 
-  res_ret.clear();  // reuse res_ret
+  if (handle < 0) {
+    debug_printf("No request waiting for req_seq_no %u\n",
+                 received_req_seq_no);
+    return;
+  }
+
+#ifdef RC_CLAIM_DELAY_US
+  // host tests widen the hand over to race rc_request_release against it
+  delayMicroseconds(RC_CLAIM_DELAY_US);
+#endif
+
+  PendingRequest& p = _pending[handle];
+  uint32_t rtt = micros() - p.sent_us;
+  _stats.requests.fetch_add(1, std::memory_order_relaxed);
+  _stats.rtt_total_us.fetch_add(rtt, std::memory_order_relaxed);
+  uint32_t rtt_max = _stats.rtt_max_us.load(std::memory_order_relaxed);
+  while (rtt > rtt_max && !_stats.rtt_max_us.compare_exchange_weak(
+                              rtt_max, rtt, std::memory_order_relaxed)) {
+  }
+  _stats.bytes_received.fetch_add(response.size(), std::memory_order_relaxed);
+  _stats.notifications.fetch_add(_resp_notifications,
+                                 std::memory_order_relaxed);
+
+  RequestState result;
+  if (received_req_type != p.req_type || received_zero != 0) {
+    debug_printf("Response header does not match request header!\n");
+    debug_printf(
+        "(expected|received) req_type: %u|%u zero: %u|%u req_seq_no: %u|%u\n",
+        p.req_type, received_req_type, 0, received_zero, p.req_seq_no,
+        received_req_seq_no);
+    result = REQUEST_FAILED;
+    _stats.failures.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    // remove compared header fields
+    response.drain(nullptr, 4);
+    p.response = _resp_buffer;
+    result = REQUEST_DONE;
+    _resp_buffer = pool_take();
+  }
+  // publishes p.response to the waiter
+  p.state.store(slot_state(received_req_seq_no, result),
+                std::memory_order_release);
 
-  mutex_enter_blocking(&_response_mutex);
-  res_ret.copy(_response);
-  _response.clear();
-  mutex_exit(&_response_mutex);
-  _response_ready = false;
+  request_complete(handle);
+}
 
-  return &res_ret;
+static size_t _resp_size = 0;     // bytes of the current response still due
+static uint8_t _resp_prefix[4];   // length prefix, may span notifications
+static size_t _resp_prefix_len = 0;
+static bool _resp_dropping = false;  // no buffer fits the current response
+
+/**
+ * @brief Drops any half reassembled response, call when the link restarts
+ *
+ */
+static void receive_reset() {
+  _resp_size = 0;
+  _resp_prefix_len = 0;
+  _resp_dropping = false;
+}
+
+/**
+ * @brief Reassembles responses from the transport, each is a 4 byte length
+ * then that many bytes, split across any number of calls
+ *
+ * A call may end one response and start the next.
+ */
+void rc_transport_receive(const uint8_t* data, size_t len) {
+  if (len > 0) _resp_notifications++;
+
+  while (len > 0) {
+    if (_resp_size == 0) {
+      // start of a response, read the length prefix first
+      size_t n = sizeof(_resp_prefix) - _resp_prefix_len;
+      if (n > len) n = len;
+      memcpy(_resp_prefix + _resp_prefix_len, data, n);
+      _resp_prefix_len += n;
+      data += n;
+      len -= n;
+      if (_resp_prefix_len < sizeof(_resp_prefix)) return;
+
+      uint32_t size;
+      memcpy(&size, _resp_prefix, sizeof(size));
+      _resp_prefix_len = 0;
+      _resp_notifications = 1;
+      if (size == 0) continue;
+      _resp_size = size;
+
+      if (_resp_buffer == nullptr) {
+        // every buffer was handed out, try again now some may be released
+        _resp_buffer = pool_take();
+      }
+      // BytesBuffer keeps one byte free
+      _resp_dropping = _resp_buffer == nullptr || size >= BLE_BUFFER_SIZE;
+      if (_resp_dropping) {
+        debug_printf("No buffer for a %u byte response, dropping it\n",
+                     size);
+      } else {
+        _resp_buffer->clear();
+      }
+    }
+
+    size_t n = len < _resp_size ? len : _resp_size;
+    if (!_resp_dropping) _resp_buffer->fill(data, n);
+    data += n;
+    len -= n;
+    _resp_size -= n;
+
+    if (_resp_size == 0 && !_resp_dropping) {
+      // copied entire message
+      route_response();
+
+      // wipe _resp_buffer, unless it was handed to a request
+      if (_resp_buffer != nullptr) _resp_buffer->clear();
+    }
+  }
+}
+
+static void notify(BLERemoteCharacteristic* /*c*/, const uint8_t* data,
+                   uint32_t len) {
+  rc_transport_receive(data, len);
+}
+
+/**
+ * @brief Sends requests over another transport instead of BLE, such as the
+ * RCEmulator
+ *
+ * @param transport nullptr goes back to BLE
+ */
+void rc_set_transport(RCTransport* transport) {
+  mutex_enter_blocking(&_write_mutex);
+  _transport = transport != nullptr ? transport : &_ble_transport;
+  receive_reset();
+  mutex_exit(&_write_mutex);
 }
 
 struct __attribute__((packed)) BLERequestHeader {
@@ -113,74 +450,275 @@ struct __attribute__((packed)) BLERequestHeader {
   uint8_t req_seq_no;
 };
 
-static BytesBuffer* execute(uint16_t req_type, uint8_t* args, size_t len) {
+/**
+ * @brief Claims a free request slot and publishes it to notify, before
+ * anything is written so a fast response always finds it
+ *
+ * @return int Handle, -1 when RC_MAX_PENDING requests are already in flight
+ */
+static int claim_request(uint16_t req_type, rc_request_callback callback,
+                         void* ctx) {
   static uint16_t seq = 0;
-  // Serial.println("execute");
-  uint8_t req_seq_no = 0x80 + seq;
+
+  int handle = -1;
+  mutex_enter_blocking(&_pending_mutex);
+  for (int i = 0; i < RC_MAX_PENDING; i++) {
+    // only the tasks free slots, so FREE can't change under the lock
+    uint16_t state = _pending[i].state.load(std::memory_order_acquire);
+    if (state_of(state) == REQUEST_FREE) {
+      handle = i;
+      break;
+    }
+  }
+  if (handle < 0) {
+    mutex_exit(&_pending_mutex);
+    debug_printf("Too many requests in flight\n");
+    return -1;
+  }
+
+  PendingRequest& p = _pending[handle];
+  p.req_type = req_type;
+  p.req_seq_no = 0x80 + seq;
   seq = (seq + 1) % 32;
+  p.sent_time = millis();
+  p.sent_us = micros();
+  p.callback = callback;
+  p.ctx = ctx;
+  p.response = nullptr;
+#ifdef __FREERTOS
+  xSemaphoreTake(p.done, 0);  // drop a give nobody waited for
+#endif
+  // publishes the fields above to notify
+  p.state.store(slot_state(p.req_seq_no, REQUEST_PENDING),
+                std::memory_order_release);
+  mutex_exit(&_pending_mutex);
+  return handle;
+}
 
+/**
+ * @brief Writes the claimed request's header and arguments to out
+ *
+ * @return size_t Bytes written, sizeof(BLERequestHeader) + len
+ */
+static size_t frame_request(int handle, const uint8_t* args, size_t len,
+                            uint8_t* out) {
   BLERequestHeader header;
   header.length =
       len + sizeof(BLERequestHeader) - 4;  // length does not include itself
-  header.req_type = req_type;
+  header.req_type = _pending[handle].req_type;
   header.zero = 0;
-  header.req_seq_no = req_seq_no;
+  header.req_seq_no = _pending[handle].req_seq_no;
+
+  memcpy(out, &header, sizeof(BLERequestHeader));
+  if (args != NULL) {
+    memcpy(out + sizeof(BLERequestHeader), args, len);
+  }
+  return sizeof(BLERequestHeader) + len;
+}
+
+/**
+ * @brief Writes framed requests in chunks of at most the negotiated size
+ *
+ */
+static void send_requests(const uint8_t* buffer, size_t len) {
+  mutex_enter_blocking(&_write_mutex);
+  size_t chunk = _chunk_size;
+  uint32_t writes = 0;
+  for (size_t i = 0; i < len; i += chunk) {
+    // write write_fd
+    size_t chunk_size = (len - i > chunk) ? chunk : (len - i);
+    _transport->write(buffer + i, chunk_size);
+    writes++;
+  }
+  mutex_exit(&_write_mutex);
+
+  _stats.bytes_sent.fetch_add(len, std::memory_order_relaxed);
+  _stats.writes.fetch_add(writes, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Sends a request without waiting for its response
+ *
+ * @return int Handle for rc_request_wait/rc_request_release, -1 when not
+ * connected or RC_MAX_PENDING requests are already in flight
+ */
+int rc_request_async(uint16_t req_type, uint8_t* args, size_t len,
+                     rc_request_callback callback, void* ctx) {
+  if (!_transport->connected()) return -1;
+
+  int handle = claim_request(req_type, callback, ctx);
+  if (handle < 0) return -1;
 
   //                 header                data
   uint8_t buffer[sizeof(BLERequestHeader) + len];
-  memcpy(buffer, &header, sizeof(BLERequestHeader));
-  if (args != NULL) {
-    memcpy(buffer + sizeof(BLERequestHeader), args, len);
+  frame_request(handle, args, len, buffer);
+  send_requests(buffer, sizeof(buffer));
+  return handle;
+}
+
+/**
+ * @brief Fails requests that have waited longer than BLE_RESPONSE_TIMEOUT,
+ * only needed when relying on callbacks alone
+ *
+ */
+void rc_request_poll() {
+  for (int i = 0; i < RC_MAX_PENDING; i++) {
+    PendingRequest& p = _pending[i];
+    uint16_t state = p.state.load(std::memory_order_acquire);
+    if (state_of(state) != REQUEST_PENDING ||
+        millis() - p.sent_time <= BLE_RESPONSE_TIMEOUT) {
+      continue;
+    }
+    // loses to a response notify claimed meanwhile
+    if (!p.state.compare_exchange_strong(
+            state, slot_state(p.req_seq_no, REQUEST_FAILED),
+            std::memory_order_acq_rel)) {
+      continue;
+    }
+
+    _stats.failures.fetch_add(1, std::memory_order_relaxed);
+    debug_printf("timeout req_seq_no %u\n", p.req_seq_no);
+    request_complete(i);
   }
+}
+
+bool rc_request_done(int handle) {
+  if (handle < 0 || handle >= RC_MAX_PENDING) return true;
+  rc_request_poll();
+  return !state_waiting(_pending[handle].state.load(std::memory_order_acquire));
+}
 
-  // Serial.println("Sending buffer:");
-  // for(auto c : buffer){
-  //   debug_printf("%02x ", c);
-  // }
-  // Serial.println();
+/**
+ * @brief Sleeps until the request finishes or times out
+ *
+ * @return BytesBuffer* Response without its header, valid until
+ * rc_request_release, nullptr on failure
+ */
+BytesBuffer* rc_request_wait(int handle) {
+  if (handle < 0 || handle >= RC_MAX_PENDING) return nullptr;
+  PendingRequest& p = _pending[handle];
+
+  uint16_t state;
+  while (state_waiting(state = p.state.load(std::memory_order_acquire))) {
+    uint32_t waited = millis() - p.sent_time;
+    if (waited > BLE_RESPONSE_TIMEOUT) {
+      // fails it, unless notify is handing over its response right now
+      rc_request_poll();
+      continue;
+    }
+#ifdef __FREERTOS
+    // sleep until notify gives the semaphore or the request times out
+    xSemaphoreTake(p.done, pdMS_TO_TICKS(BLE_RESPONSE_TIMEOUT - waited + 1));
+#else
+    delay(1);
+#endif
+  }
 
-  BytesBuffer* response = ble_execute(buffer, len + sizeof(BLERequestHeader));
+  return state_of(state) == REQUEST_DONE ? p.response : nullptr;
+}
 
-  // timeout occurred
-  if(response == nullptr){
-    return nullptr; 
+/**
+ * @brief Frees the request slot, every handle must be released once
+ *
+ */
+void rc_request_release(int handle) {
+  if (handle < 0 || handle >= RC_MAX_PENDING) return;
+  PendingRequest& p = _pending[handle];
+  // fail a pending request so a late response for its req_seq_no is dropped
+  // by route_response. One being handed over right now is waited out without
+  // holding _pending_mutex, sleeping after a short spin so a lower priority
+  // notify on this core gets to finish the hand over
+  uint16_t state = p.state.load(std::memory_order_acquire);
+  for (int spins = 0; state_waiting(state); spins++) {
+    if (state_of(state) == REQUEST_PENDING) {
+      if (p.state.compare_exchange_weak(
+              state, slot_state(p.req_seq_no, REQUEST_FAILED),
+              std::memory_order_acquire)) {
+        break;
+      }
+      continue;
+    }
+    if (spins < RC_RELEASE_SPINS) {
+      tight_loop_contents();
+    } else {
+      delay(1);
+    }
+    state = p.state.load(std::memory_order_acquire);
   }
 
-  // check header
-  // get header
-  uint16_t received_req_type = response->consume<uint16_t>();
-  uint8_t received_zero = response->consume<uint8_t>();
-  uint8_t received_req_seq_no = response->consume<uint8_t>();
-  if (received_req_type != header.req_type || received_zero != header.zero ||
-      received_req_seq_no != header.req_seq_no) {
-    debug_printf("Response header does not match request header!\n");
-    debug_printf(
-        "(expected|received) req_type: %u|%u zero: %u|%u req_seq_no: %u|%u\n",
-        header.req_type, received_req_type, header.zero, received_zero,
-        header.req_seq_no, received_req_seq_no);
+  // DONE or FAILED, notify won't touch the slot again
+  mutex_enter_blocking(&_pending_mutex);
+  if (state_of(state) == REQUEST_DONE) pool_give(p.response);
+  p.response = nullptr;
+  p.state.store(REQUEST_FREE, std::memory_order_release);
+  mutex_exit(&_pending_mutex);
+}
 
+/**
+ * @brief Blocking request, the response stays valid until the next blocking
+ * request
+ *
+ */
+static BytesBuffer* execute(uint16_t req_type, uint8_t* args, size_t len) {
+  int handle = rc_request_async(req_type, args, len);
+  BytesBuffer* response = rc_request_wait(handle);
+
+  // timeout occurred
+  if (response == nullptr) {
+    rc_request_release(handle);
     return nullptr;
   }
 
-  // remove compared header fields
+  // keep the response buffer instead of copying it out of the slot
+  mutex_enter_blocking(&_pending_mutex);
+  pool_give(res_ret);
+  res_ret = response;
+  _pending[handle].response = nullptr;
+  mutex_exit(&_pending_mutex);
 
-  return response;
+  rc_request_release(handle);
+  return res_ret;
 }
 
 void radiacode_ble_init(){
-  mutex_init(&_response_mutex); 
+  mutex_init(&_pending_mutex);
+  mutex_init(&_write_mutex);
+  for (int i = 0; i < RC_MAX_PENDING; i++) {
+    _pending[i].state.store(REQUEST_FREE, std::memory_order_relaxed);
+    _pending[i].response = nullptr;
+#ifdef __FREERTOS
+    _pending[i].done = xSemaphoreCreateBinary();
+#endif
+  }
+  for (int i = 0; i < RC_BUFFER_POOL_SIZE; i++) {
+    pool_give(new BytesBuffer(BLE_BUFFER_SIZE));
+  }
+  _resp_buffer = pool_take();
 
   debug_printf("Starting BLE Client\n");
 
   BLE.begin();
 
+  _hci_registration.callback = &hci_event;
+  async_context_t* context = cyw43_arch_async_context();
+  async_context_acquire_lock_blocking(context);
+  hci_add_event_handler(&_hci_registration);
+  async_context_release_lock(context);
+
   debug_printf("Done."); 
 }
 
-uint8_t radiacode_ble_connect(String target_mac, bool verbose) {
+/**
+ * @brief Scans for the RadiaCode and connects to it
+ *
+ * @return uint8_t 0 on success, 1 if the connection failed, 5 if the device
+ * was not found
+ */
+uint8_t radiacode_ble_find(String target_mac, bool verbose) {
   if (verbose) debug_printf("Scanning...\n");
 
   BLEScanReport* res = BLE.scan();
+  if (res == nullptr) return 5;
 
   for (BLEAdvertising item : *res) {
     if (item.getAddress().toString() == target_mac) {
@@ -189,12 +727,67 @@ uint8_t radiacode_ble_connect(String target_mac, bool verbose) {
         if (verbose) debug_printf("Failed.\n");
         return 1; 
       }
-      break;
+      if (verbose) debug_printf("Done.\n");
+      return 0;
+    }
+  }
+
+  if (verbose) debug_printf("Device not found\n");
+  return 5;
+}
+
+/**
+ * @brief Sizes writes from the MTU the link negotiated and looks up whether
+ * the write characteristic takes writes without response. Either falls back
+ * to RC_BLE_MTU and acknowledged writes
+ *
+ */
+static void ble_link_setup(bool verbose) {
+  _write_without_response = false;
+  hci_con_handle_t handle = _con_handle;
+  uint16_t mtu = RC_BLE_MTU;
+  uint8_t err = ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+
+  async_context_t* context = cyw43_arch_async_context();
+  if (handle != HCI_CON_HANDLE_INVALID) {
+    async_context_acquire_lock_blocking(context);
+    // BTstack exchanged the MTU before the first discovery query
+    if (gatt_client_get_mtu(handle, &mtu) != ERROR_CODE_SUCCESS) {
+      mtu = RC_BLE_MTU;
     }
+    _write_query_found = false;
+    _write_query_done = false;
+    err = gatt_client_discover_characteristics_for_handle_range_by_uuid128(
+        &write_query_event, handle, 0x0001, 0xffff, rc_write_uuid128);
+    async_context_release_lock(context);
   }
+  rc_ble_set_mtu(mtu);
 
-  if (verbose) debug_printf("Done.\n");
+  if (err == ERROR_CODE_SUCCESS) {
+    uint32_t start = millis();
+    while (!_write_query_done && millis() - start < BLE_RESPONSE_TIMEOUT) {
+      delay(1);
+    }
+    _write_without_response =
+        _write_query_done && _write_query_found &&
+        (_write_characteristic.properties &
+         ATT_PROPERTY_WRITE_WITHOUT_RESPONSE) != 0;
+  }
 
+  if (verbose) {
+    debug_printf("MTU %u, %u byte writes %s response\n", mtu, _chunk_size,
+                 _write_without_response ? "without" : "with");
+  }
+}
+
+/**
+ * @brief Finds the RadiaCode service and characteristics on the connected
+ * device and subscribes to responses
+ *
+ * @return uint8_t 0 on success, 2 no notify char, 3 no write char, 4 no
+ * service
+ */
+uint8_t radiacode_ble_discover(bool verbose) {
   if (verbose) debug_printf("Exploring service...\n");
   BLERemoteService* service = BLE.client()->service(rc_service_uuid);
 
@@ -202,6 +795,7 @@ uint8_t radiacode_ble_connect(String target_mac, bool verbose) {
     rc_notify_char = service->characteristic(rc_notify_uuid);
     if (rc_notify_char) {
       if (verbose) debug_printf("Found notify char\n");
+      receive_reset();  // drop any half reassembled response
       rc_notify_char->onNotify(notify);
       rc_notify_char->enableNotifications();
     } else {
@@ -220,13 +814,87 @@ uint8_t radiacode_ble_connect(String target_mac, bool verbose) {
     return 4; 
   }
 
+  ble_link_setup(verbose);
+  return 0;
+}
+
+/**
+ * @brief Sends the SET_EXCHANGE the RadiaCode expects before any request
+ *
+ * @return uint8_t 0 on success, 6 on no response
+ */
+uint8_t radiacode_ble_exchange() {
   // init?
   uint8_t data[] = {0x01, 0xff, 0x12, 0xff};
-  execute(Command::SET_EXCHANGE, data, sizeof(data));
-
+  if (execute(Command::SET_EXCHANGE, data, sizeof(data)) == nullptr) return 6;
   return 0;
 }
 
+uint8_t radiacode_ble_connect(String target_mac, bool verbose) {
+  uint8_t res = radiacode_ble_find(target_mac, verbose);
+  if (res == 0) res = radiacode_ble_discover(verbose);
+  if (res == 0) res = radiacode_ble_exchange();
+  return res;
+}
+
+/**
+ * @brief Get if the RadiaCode is connected and its characteristics found,
+ * or the transport set with rc_set_transport is connected
+ *
+ * @return true
+ * @return false
+ */
+bool radiacode_ble_connected() { return _transport->connected(); }
+
+/**
+ * @brief Sets the ATT MTU requests are split for, radiacode_ble_discover
+ * sets the MTU the link negotiated
+ *
+ * @param mtu Negotiated ATT MTU, at least RC_BLE_MTU
+ */
+void rc_ble_set_mtu(uint16_t mtu) {
+  if (mtu < RC_BLE_MTU) mtu = RC_BLE_MTU;
+  mutex_enter_blocking(&_write_mutex);
+  _chunk_size = mtu - 3;
+  mutex_exit(&_write_mutex);
+}
+
+/**
+ * @brief Get the bytes written per GATT write
+ *
+ * @return uint16_t
+ */
+uint16_t rc_ble_chunk_size() { return _chunk_size; }
+
+/**
+ * @brief Whether requests go out as writes without response on this link
+ *
+ * @return bool
+ */
+bool rc_ble_writes_without_response() { return _write_without_response; }
+
+/**
+ * @brief Copies the link statistics
+ *
+ * @param stats Destination
+ * @param reset Start a new measurement window after copying
+ */
+void rc_ble_get_stats(RCBleStats* stats, bool reset) {
+  // each counter is read, and reset, on its own
+  auto take = [reset](std::atomic<uint32_t>& counter) {
+    return reset ? counter.exchange(0, std::memory_order_relaxed)
+                 : counter.load(std::memory_order_relaxed);
+  };
+  stats->requests = take(_stats.requests);
+  stats->failures = take(_stats.failures);
+  stats->rtt_total_us = take(_stats.rtt_total_us);
+  stats->rtt_max_us = take(_stats.rtt_max_us);
+  stats->bytes_sent = take(_stats.bytes_sent);
+  stats->writes = take(_stats.writes);
+  stats->bytes_received = take(_stats.bytes_received);
+  stats->notifications = take(_stats.notifications);
+}
+
 void radiacode_ble_disconnect(){
   if(BLE.client() && BLE.client()->connected()){
     BLE.client()->disconnect(); 
@@ -234,6 +902,8 @@ void radiacode_ble_disconnect(){
 
   rc_write_char = nullptr; 
   rc_notify_char = nullptr; 
+  _write_without_response = false;
+  receive_reset();
 }
 
 uint8_t write_request(int command_id, uint8_t* data, size_t len) {
@@ -258,11 +928,11 @@ uint8_t write_request(int command_id, uint8_t* data, size_t len) {
   return 0; 
 }
 
-BytesBuffer* read_request(uint32_t command_id) {
-  // Serial.println("read_request");
-  BytesBuffer* r =
-      execute(Command::RD_VIRT_STRING, (uint8_t*)&command_id, sizeof(int));
-
+/**
+ * @brief Strips the retcode and length from a RD_VIRT_STRING response
+ *
+ */
+static BytesBuffer* read_response(BytesBuffer* r) {
   if (r == nullptr) return nullptr;
 
   uint32_t retcode = r->consume<uint32_t>();
@@ -271,7 +941,7 @@ BytesBuffer* read_request(uint32_t command_id) {
   if (retcode != 1) {
     debug_printf("Bad retcode %x\n", retcode);
     debug_printf("flen: %x\n", flen);
-    for (int i = 0; i < r->size(); i++) {
+    for (size_t i = 0; i < r->size(); i++) {
       debug_printf("%02x ", r->at(i));
     }
     return nullptr;
@@ -290,94 +960,291 @@ BytesBuffer* read_request(uint32_t command_id) {
   return r;
 }
 
+BytesBuffer* read_request(uint32_t command_id) {
+  // Serial.println("read_request");
+  return read_response(
+      execute(Command::RD_VIRT_STRING, (uint8_t*)&command_id, sizeof(int)));
+}
+
+int read_request_async(uint32_t command_id, rc_request_callback callback,
+                       void* ctx) {
+  return rc_request_async(Command::RD_VIRT_STRING, (uint8_t*)&command_id,
+                          sizeof(int), callback, ctx);
+}
+
+BytesBuffer* read_request_wait(int handle) {
+  return read_response(rc_request_wait(handle));
+}
+
+/**
+ * @brief Sends several RD_VIRT_STRING reads in one write, so the RadiaCode
+ * handles them back to back without a round trip between them
+ *
+ * @param command_ids What to read, at most RC_MAX_PENDING
+ * @param handles One handle per read, to wait on and release as any other
+ * @return false if nothing was sent, when not connected or not enough
+ * request slots are free
+ */
+bool read_requests_async(const uint32_t* command_ids, uint8_t n,
+                         int* handles) {
+  if (n == 0 || n > RC_MAX_PENDING || !_transport->connected()) return false;
+
+  for (uint8_t i = 0; i < n; i++) {
+    handles[i] = claim_request(Command::RD_VIRT_STRING, nullptr, nullptr);
+    if (handles[i] < 0) {
+      // fails the ones already claimed, they were never sent
+      for (uint8_t j = 0; j < i; j++) rc_request_release(handles[j]);
+      return false;
+    }
+  }
+
+  uint8_t buffer[RC_MAX_PENDING * (sizeof(BLERequestHeader) + sizeof(int))];
+  size_t len = 0;
+  for (uint8_t i = 0; i < n; i++) {
+    len += frame_request(handles[i], (const uint8_t*)&command_ids[i],
+                         sizeof(int), buffer + len);
+  }
+  send_requests(buffer, len);
+  return true;
+}
+
+/**
+ * @brief Reads several VSFRs in one exchange instead of one RD_VIRT_SFR each
+ *
+ * @param ids VSFR ids, at most RC_VSFR_BATCH_MAX
+ * @param values Raw 32 bit value of each id, see decode_realtime_vsfrs for
+ * how they are laid out
+ * @return uint8_t 0 on success, 1 on no response, 2 if any id was not
+ * valid, 3 on a short response
+ */
+uint8_t read_vsfr_batch(const uint32_t* ids, uint8_t n, uint32_t* values) {
+  int handle = read_vsfr_batch_async(ids, n);
+  if (handle < 0) return 1;
+  uint8_t res = read_vsfr_batch_wait(handle, n, values);
+  rc_request_release(handle);
+  return res;
+}
+
+/**
+ * @brief Sends a RD_VIRT_SFR_BATCH without waiting, collect it with
+ * read_vsfr_batch_wait
+ *
+ * @return int Handle, -1 if it could not be sent
+ */
+int read_vsfr_batch_async(const uint32_t* ids, uint8_t n,
+                          rc_request_callback callback, void* ctx) {
+  if (n == 0 || n > RC_VSFR_BATCH_MAX) return -1;
+
+  // count, then the ids
+  uint32_t args[1 + RC_VSFR_BATCH_MAX];
+  args[0] = n;
+  memcpy(args + 1, ids, n * sizeof(uint32_t));
+  return rc_request_async(Command::RD_VIRT_SFR_BATCH, (uint8_t*)args,
+                          (1 + n) * sizeof(uint32_t), callback, ctx);
+}
+
+/**
+ * @brief Waits for a RD_VIRT_SFR_BATCH and copies out its values, the
+ * handle still has to be released
+ *
+ * @param n Number of ids the request was sent with
+ * @return uint8_t Same as read_vsfr_batch
+ */
+uint8_t read_vsfr_batch_wait(int handle, uint8_t n, uint32_t* values) {
+  BytesBuffer* r = rc_request_wait(handle);
+  if (r == nullptr) return 1;
+
+  // a validity bit per id, then a 32 bit value per id
+  uint32_t valid;
+  if (!r->try_consume(valid) || !r->consume_array(values, n)) {
+    debug_printf("Short VSFR batch response\n");
+    return 3;
+  }
+  uint32_t expected = n == 32 ? 0xFFFFFFFF : (1UL << n) - 1;
+  if (valid != expected) {
+    debug_printf("Invalid VSFRs in batch %08x != %08x\n", valid, expected);
+    return 2;
+  }
+  return 0;
+}
+
+const uint32_t RC_REALTIME_VSFRS[RC_REALTIME_VSFR_COUNT] = {
+    VSFR::CPS,   VSFR::DR_uR_h, VSFR::DS_uR, VSFR::TEMP_degC,
+    VSFR::ACC_X, VSFR::ACC_Y,   VSFR::ACC_Z};
+
+/**
+ * @brief Converts the raw values of a RC_REALTIME_VSFRS batch read
+ *
+ * @param values RC_REALTIME_VSFR_COUNT values from read_vsfr_batch
+ */
+void decode_realtime_vsfrs(const uint32_t* values, RCRealTimeValues* out) {
+  out->count_rate_cps = values[0];
+  out->dose_rate_uR_h = values[1];
+  out->dose_uR = values[2];
+  memcpy(&out->temperature_c, &values[3], sizeof(float));
+  // the accelerometer is a 16 bit value in the upper half of the word
+  out->acc_x = (int16_t)(values[4] >> 16);
+  out->acc_y = (int16_t)(values[5] >> 16);
+  out->acc_z = (int16_t)(values[6] >> 16);
+}
+
 String decode_cp1251(BytesBuffer* data) {
   String res;
 
   while (data->empty() == false) {
-    char c = data->consume<char>();
-    if (c < 0x80) res += c;
+    // unsigned, char is signed on some targets
+    uint8_t c = data->consume<uint8_t>();
+    if (c < 0x80) res += (char)c;
     // probably don't need the cyrillic character - maybe later
     else if (c >= 0xC0 && c <= 0xDF)
       res += '_';  //(char)(0x0410 + (c - 0xC0));
-    else if (c >= 0xE0 && c <= 0xFF)
+    else if (c >= 0xE0)
       res += '_';  //(char)(0x0430 + (c - 0xE0));
     else if (c == 0xA8)
       res += '_';  //(char)0x0401;
     else if (c == 0xB8)
       res += '_';  //(char)0x0451;
     else
-      res += c;  // unknown character
+      res += (char)c;  // unknown character
   }
 
   return res;
 }
 
-uint8_t decode_spectrum(BytesBuffer* data, int* ret, float& a0, float& a1,
-                        float& a2, uint32_t& ts) {
-  // ret is assumed to be an array of len 1024
+template <bool ACCUMULATE>
+static inline void store_bin(int& bin, int value) {
+  if (ACCUMULATE) {
+    bin += value;
+  } else {
+    bin = value;
+  }
+}
+
+/**
+ * @brief Decodes a SPECTRUM or SPEC_DIFF response, either into ret or added
+ * onto it
+ *
+ */
+template <bool ACCUMULATE>
+static uint8_t decode_spectrum_runs(BytesBuffer* data, int* ret, float& a0,
+                                    float& a1, float& a2, uint32_t& ts) {
+  // ret is assumed to be an array of len RC_SPECTRUM_CHANNELS
   if(data == nullptr) return 1; 
 
   // read first bytes
-  ts = data->consume<uint32_t>();
-  a0 = data->consume<float>();
-  a1 = data->consume<float>();
-  a2 = data->consume<float>();
+  if (!data->try_consume(ts) || !data->try_consume(a0) ||
+      !data->try_consume(a1) || !data->try_consume(a2)) {
+    debug_printf("Spectrum too short for a header\n");
+    return 1;
+  }
+
+  // bytes per value for each vlen
+  static const uint8_t VLEN_BYTES[] = {0, 1, 1, 2, 3, 4};
+
+  ByteSpan bytes = data->span();
+  const uint8_t* place = bytes.data;
+  const uint8_t* end = bytes.data + bytes.size;
 
   size_t ret_it = 0;
   int last = 0;
-  int v = 0;
-  while (data->empty() == false) {  // place < data->data() + data->size()){
-    uint16_t u16 = data->consume<uint16_t>();
+  while (end - place >= 2) {
+    uint16_t u16;
+    memcpy(&u16, place, sizeof(u16));
+    place += sizeof(u16);
     uint16_t cnt = (u16 >> 4) & 0x0FFF;
     uint16_t vlen = u16 & 0x0F;
 
-    for (int i = 0; i < cnt; i++) {
-      if (vlen == 0) {
-        v = 0;
-      } else if (vlen == 1) {
-        // unpack('<B')
-        uint8_t b = data->consume<uint8_t>();
+    if (cnt == 0) continue;
+    if (vlen >= sizeof(VLEN_BYTES)) {
+      debug_printf("Unsupported vlen %u\n", vlen);
+      return 1;
+    }
+    // check the whole run once instead of every value
+    if ((size_t)(end - place) < (size_t)cnt * VLEN_BYTES[vlen] ||
+        ret_it + cnt > RC_SPECTRUM_CHANNELS) {
+      debug_printf("Truncated spectrum\n");
+      return 1;
+    }
 
-        v = b;
-      } else if (vlen == 2) {
+    int* out = ret + ret_it;
+    ret_it += cnt;
+    switch (vlen) {
+      case 0:
+        if (!ACCUMULATE) {
+          for (int i = 0; i < cnt; i++) out[i] = 0;
+        }
+        last = 0;
+        break;
+      case 1:
+        // unpack('<B')
+        for (int i = 0; i < cnt; i++) store_bin<ACCUMULATE>(out[i], place[i]);
+        last = place[cnt - 1];
+        break;
+      case 2:
         // last + unpack('<b')
-        int8_t b = data->consume<int8_t>();
-
-        v = last + b;
-      } else if (vlen == 3) {
+        for (int i = 0; i < cnt; i++) {
+          last += (int8_t)place[i];
+          store_bin<ACCUMULATE>(out[i], last);
+        }
+        break;
+      case 3:
         // last + unpack('<h')
-        int16_t h = data->consume<int16_t>();
-
-        v = last + h;
-      } else if (vlen == 4) {
+        for (int i = 0; i < cnt; i++) {
+          int16_t h;
+          memcpy(&h, place + 2 * i, sizeof(h));
+          last += h;
+          store_bin<ACCUMULATE>(out[i], last);
+        }
+        break;
+      case 4:
         // a, b, c = unpack('<BBb')
-        uint8_t a = data->consume<uint8_t>();
-        uint8_t b = data->consume<uint8_t>();
-        int8_t c = data->consume<int8_t>();
-
-        v = last + ((c << 16) | (b << 8) | a);
-      } else if (vlen == 5) {
+        for (int i = 0; i < cnt; i++) {
+          const uint8_t* v = place + 3 * i;
+          last += ((int8_t)v[2] << 16) | (v[1] << 8) | v[0];
+          store_bin<ACCUMULATE>(out[i], last);
+        }
+        break;
+      case 5:
         // last + unpack('<i')
-        int32_t i = data->consume<int32_t>();
-
-        v = last + i;
-      } else {
-        debug_printf("Unsupported vlen %u\n", vlen);
-        return 1;
-      }
-
-      last = v;
-      ret[ret_it++] = v;
+        for (int i = 0; i < cnt; i++) {
+          int32_t v;
+          memcpy(&v, place + 4 * i, sizeof(v));
+          last += v;
+          store_bin<ACCUMULATE>(out[i], last);
+        }
+        break;
     }
+    place += cnt * VLEN_BYTES[vlen];
   }
 
+  data->drain(nullptr, place - bytes.data);
   return 0;
 }
 
+uint8_t decode_spectrum(BytesBuffer* data, int* ret, float& a0, float& a1,
+                        float& a2, uint32_t& ts) {
+  return decode_spectrum_runs<false>(data, ret, a0, a1, a2, ts);
+}
+
+/**
+ * @brief Adds a SPEC_DIFF response onto an accumulated spectrum
+ *
+ * @param data SPEC_DIFF response
+ * @param ret Accumulated spectrum of RC_SPECTRUM_CHANNELS counts, only
+ * partly updated if decoding fails
+ * @return uint8_t 0 on success
+ */
+uint8_t accumulate_spectrum(BytesBuffer* data, int* ret, float& a0, float& a1,
+                            float& a2, uint32_t& ts) {
+  return decode_spectrum_runs<true>(data, ret, a0, a1, a2, ts);
+}
+
 BytesBuffer* readSpectrumData(){
   return read_request(VS::SPECTRUM);
 }
 
+BytesBuffer* readSpectrumDiff() { return read_request(VS::SPEC_DIFF); }
+
 void printSpectrum() {
   BytesBuffer* r = read_request(VS::SPECTRUM);
 
@@ -388,11 +1255,11 @@ void printSpectrum() {
 
   float a0, a1, a2;
   uint32_t ts;
-  int spectrum[1024];
+  int spectrum[RC_SPECTRUM_CHANNELS];
   decode_spectrum(r, spectrum, a0, a1, a2, ts);
   always_printf("a0: %f, a1: %f, a2: %f, ts: %u\n", a0, a1, a2, ts);
   always_printf("Spectrum:\n");
-  for (int i = 0; i < 1024; i++) {
+  for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) {
     always_printf("%d, ", spectrum[i]);
   }
   always_printf("\n");
@@ -404,7 +1271,7 @@ DataPoint consume_data_buf(BytesBuffer* r) {
     return RCError();
   }
 
-  uint8_t seq = r->consume<uint8_t>();
+  r->consume<uint8_t>();  // seq
   uint8_t eid = r->consume<uint8_t>();
   uint8_t gid = r->consume<uint8_t>();
   int32_t ts_offset = r->consume<int32_t>();
@@ -490,7 +1357,7 @@ DataPoint consume_data_buf(BytesBuffer* r) {
       // ???
       if(r->size() < (2 + 4)) return RCError(); 
       uint16_t samples_num = r->consume<uint16_t>();
-      uint32_t smpl_time_ms = r->consume<uint32_t>();
+      r->consume<uint32_t>();  // smpl_time_ms
 
       if(r->size() < (8 * samples_num)) return RCError(); 
       r->drain(nullptr, 8 * samples_num);
@@ -499,7 +1366,7 @@ DataPoint consume_data_buf(BytesBuffer* r) {
       // ???
       if(r->size() < (2 + 4)) return RCError(); 
       uint16_t samples_num = r->consume<uint16_t>();
-      uint32_t smpl_time_ms = r->consume<uint32_t>();
+      r->consume<uint32_t>();  // smpl_time_ms
       
       if(r->size() < (16 * samples_num)) return RCError(); 
       r->drain(nullptr, 16 * samples_num);
@@ -508,7 +1375,7 @@ DataPoint consume_data_buf(BytesBuffer* r) {
       // ???
       if(r->size() < (2 + 4)) return RCError(); 
       uint16_t samples_num = r->consume<uint16_t>();
-      uint32_t smpl_time_ms = r->consume<uint32_t>();
+      r->consume<uint32_t>();  // smpl_time_ms
 
       if(r->size() < (14 * samples_num)) return RCError(); 
       r->drain(nullptr, 14 * samples_num);
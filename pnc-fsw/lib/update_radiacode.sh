@@ -1,5 +1,25 @@
 #!/bin/bash
+# RadiaCodeBLELib is maintained in this tree (it carries the async requests,
+# buffer pool, MTU handling and VSFR batching that the upstream copy in
+# RadiaCode_Controller_BLE does not). Re-copying it from upstream would throw
+# those changes away, so by default this only shows how the two differ.
+# Pass --force to replace the in-tree copy with upstream anyway.
 
-rm -rf RadiaCodeBLELib 
+cd "$(dirname "$0")" || exit 1
 
-cp -r ../../../RadiaCode_Controller_BLE/lib/RadiaCodeBLELib .
\ No newline at end of file
+UPSTREAM=../../../RadiaCode_Controller_BLE/lib/RadiaCodeBLELib
+
+if [ ! -d "$UPSTREAM" ]; then
+  echo "upstream library not found at $UPSTREAM" >&2
+  exit 1
+fi
+
+if [ "$1" != "--force" ]; then
+  diff -ru "$UPSTREAM" RadiaCodeBLELib
+  echo "in-tree RadiaCodeBLELib left unchanged, rerun with --force to" \
+    "replace it with upstream" >&2
+  exit 0
+fi
+
+rm -rf RadiaCodeBLELib
+cp -r "$UPSTREAM" .
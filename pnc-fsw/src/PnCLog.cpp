@@ -0,0 +1,90 @@
+#include "PnCLog.h"
+
+static size_t put_checksum(uint8_t* out, uint8_t* pos) {
+  // sum complement checksum like the spectrum records
+  int8_t sum = 0;
+  for (uint8_t* b = out; b < pos; b++) sum += *b;
+  *pos = -sum;
+  return pos + sizeof(int8_t) - out;
+}
+
+/**
+ * @brief Construct a new PnCLog object, the first record holds every group
+ *
+ */
+PnCLog::PnCLog() { this->reset(); }
+
+/**
+ * @brief Makes the next record hold every group written so far, call when a
+ * record could not be stored or a new file is started
+ *
+ */
+void PnCLog::reset() { this->full_next = true; }
+
+/**
+ * @brief Encodes the schema header naming every group and its size, so a
+ * decoder can skip groups it doesn't know
+ *
+ * @param out Buffer of at least PNC_LOG_HEADER_SIZE bytes
+ * @return size_t Length of the header written to out
+ */
+size_t PnCLog::encode_header(uint8_t* out) {
+  PnCLogHeader header;
+  header.group_count = SYSVAR_COUNT;
+  header.length = PNC_LOG_HEADER_SIZE;
+  memcpy(out, &header, sizeof(header));
+
+  uint8_t* pos = out + sizeof(header);
+#define PNC_GROUP_ENTRY(var, type)                \
+  {                                               \
+    PnCLogGroup group = {};                       \
+    group.id = SYSVAR_ID_##var;                   \
+    group.size = sizeof(type);                    \
+    strncpy(group.name, #var, PNC_LOG_NAME_SIZE); \
+    memcpy(pos, &group, sizeof(group));           \
+    pos += sizeof(group);                         \
+  }
+  SYSVAR_LIST(PNC_GROUP_ENTRY)
+#undef PNC_GROUP_ENTRY
+
+  return put_checksum(out, pos);
+}
+
+/**
+ * @brief Encodes the groups changed in a snapshot as a record
+ *
+ * @param snapshot Snapshot reused between calls, see sysvar_snapshot
+ * @param uptime PnC millis of the snapshot
+ * @param out Buffer of at least PNC_RECORD_MAX_SIZE bytes
+ * @return size_t Length of the record written to out, 0 if no group changed
+ */
+size_t PnCLog::encode(const SysVarSnapshot& snapshot, uint32_t uptime,
+                      uint8_t* out) {
+  uint32_t present = snapshot.changed;
+  if (this->full_next) {
+    // every group that has a value, unwritten ones would only be zeros
+    for (int id = 0; id < SYSVAR_COUNT; id++) {
+      if (snapshot.generation[id] != 0) present |= 1UL << id;
+    }
+  }
+  if (present == 0) return 0;
+
+  PnCRecordHeader header;
+  header.uptime = uptime;
+  header.present = present;
+
+  uint8_t* pos = out + sizeof(header);
+#define PNC_GROUP_COPY(name, type)             \
+  if (present & (1UL << SYSVAR_ID_##name)) {   \
+    memcpy(pos, &snapshot.name, sizeof(type)); \
+    pos += sizeof(type);                       \
+  }
+  SYSVAR_LIST(PNC_GROUP_COPY)
+#undef PNC_GROUP_COPY
+
+  header.length = (pos - out) + sizeof(int8_t);
+  memcpy(out, &header, sizeof(header));
+
+  this->full_next = false;
+  return put_checksum(out, pos);
+}
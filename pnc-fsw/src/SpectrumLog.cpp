@@ -0,0 +1,123 @@
+#include "SpectrumLog.h"
+
+static uint8_t* put_varint(uint8_t* pos, uint32_t value) {
+  while (value >= 0x80) {
+    *pos++ = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  *pos++ = value;
+  return pos;
+}
+
+static inline uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/**
+ * @brief Construct a new SpectrumLog object
+ *
+ * @param keyframe_interval Records between full spectra, 1 stores every
+ * spectrum in full
+ */
+SpectrumLog::SpectrumLog(uint16_t keyframe_interval) {
+  this->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+  this->reset();
+}
+
+/**
+ * @brief Makes the next record a keyframe, call when a record could not be
+ * stored so the following deltas don't depend on it
+ *
+ */
+void SpectrumLog::reset() {
+  this->has_previous = false;
+  this->previous_channels = 0;
+  this->since_keyframe = 0;
+}
+
+/**
+ * @brief Encodes a spectrum as a record and remembers it for the next delta
+ *
+ * @param spectrum Counts per channel
+ * @param channels Number of channels, at most SPECTRUM_LOG_MAX_CHANNELS
+ * @param device_ts RadiaCode spectrum timestamp
+ * @param a0 Energy calibration constant term
+ * @param a1 Energy calibration linear term
+ * @param a2 Energy calibration quadratic term
+ * @param out Buffer of at least SPECTRUM_RECORD_MAX_SIZE bytes
+ * @return size_t Length of the record written to out
+ */
+size_t SpectrumLog::encode(const int* spectrum, uint16_t channels,
+                           uint32_t device_ts, float a0, float a1, float a2,
+                           uint8_t* out) {
+  if (channels > SPECTRUM_LOG_MAX_CHANNELS) {
+    channels = SPECTRUM_LOG_MAX_CHANNELS;
+  }
+
+  SpectrumCalibration calibration = {a0, a1, a2};
+  bool keyframe = !this->has_previous || channels != this->previous_channels ||
+                  this->since_keyframe >= this->keyframe_interval ||
+                  memcmp(&calibration, &this->calibration,
+                         sizeof(calibration)) != 0;
+  if (keyframe) {
+    memset(this->previous, 0, sizeof(this->previous));
+    this->calibration = calibration;
+    this->since_keyframe = 0;
+  }
+
+  SpectrumRecordHeader header;
+  header.type = keyframe ? SPECTRUM_KEYFRAME : SPECTRUM_DELTA;
+  header.uptime = millis();
+  header.device_ts = device_ts;
+  header.channels = channels;
+
+  uint8_t* pos = out + sizeof(header);
+  if (keyframe) {
+    memcpy(pos, &calibration, sizeof(calibration));
+    pos += sizeof(calibration);
+  }
+  uint16_t i = 0;
+  while (i < channels) {
+    // run of unchanged channels
+    uint16_t zero_run = 0;
+    while (i + zero_run < channels &&
+           spectrum[i + zero_run] == this->previous[i + zero_run]) {
+      zero_run++;
+    }
+    i += zero_run;
+
+    // followed by the changed ones, a single unchanged channel between two
+    // changed ones is cheaper inline than as a new group
+    uint16_t literal_count = 0;
+    while (i + literal_count < channels) {
+      uint16_t at = i + literal_count;
+      if (spectrum[at] == this->previous[at] &&
+          (at + 1 >= channels || spectrum[at + 1] == this->previous[at + 1])) {
+        break;
+      }
+      literal_count++;
+    }
+
+    pos = put_varint(pos, zero_run);
+    pos = put_varint(pos, literal_count);
+    for (uint16_t j = i; j < i + literal_count; j++) {
+      pos = put_varint(pos, zigzag(spectrum[j] - this->previous[j]));
+      this->previous[j] = spectrum[j];
+    }
+    i += literal_count;
+  }
+
+  header.length = (pos - out) + sizeof(int8_t);
+  memcpy(out, &header, sizeof(header));
+
+  // sum complement checksum like the data packets
+  int8_t sum = 0;
+  for (uint8_t* b = out; b < pos; b++) sum += *b;
+  *pos = -sum;
+
+  this->previous_channels = channels;
+  this->has_previous = true;
+  this->since_keyframe++;
+
+  return header.length;
+}
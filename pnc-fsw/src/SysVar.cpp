@@ -1,68 +1,102 @@
 #include "SysVar.h"
 
-#include "pico/mutex.h"
+#include "pico/critical_section.h"
 
-#define SYSVAR_ACCESS_DELAY 100
+// registry lock, held only for the copies so interrupts stay off briefly
+static critical_section_t sysvar_section;
 
-// mutex
-static mutex_t sysvar_mutex;
+void sysvar_init() { critical_section_init(&sysvar_section); }
 
-void sysvar_init() { mutex_init(&sysvar_mutex); }
+void sysvar_lock() { critical_section_enter_blocking(&sysvar_section); }
+
+void sysvar_unlock() { critical_section_exit(&sysvar_section); }
 
 // System Variables
-static float pico_temp_c;
-static uint32_t rtc_time;
-static INASensorData ina_data;
-static BMESensorData bme_data;
-static GPSSensorData gps_data;
-
-// Access functions
-#define with_sysvar_mutex(operation)                                   \
-  if (mutex_try_enter_block_until(                                     \
-          &sysvar_mutex, make_timeout_time_ms(SYSVAR_ACCESS_DELAY))) { \
-    operation;                                                         \
-    mutex_exit(&sysvar_mutex);                                         \
-    return 0;                                                          \
-  } else {                                                             \
-    return -1;                                                         \
+#define SYSVAR_DEFINE(name, type) SysVar<type> sysvar_##name;
+SYSVAR_LIST(SYSVAR_DEFINE)
+#undef SYSVAR_DEFINE
+
+/**
+ * @brief Copies every system variable in one critical section so the values
+ * are mutually consistent
+ *
+ * @param snapshot Snapshot to fill, its previous generations decide changed
+ */
+void sysvar_snapshot(SysVarSnapshot* snapshot) {
+  uint32_t changed = 0;
+  sysvar_lock();
+#define SYSVAR_COPY(name, type)                                           \
+  {                                                                       \
+    uint32_t generation = sysvar_##name.getLocked(                        \
+        &snapshot->name, &snapshot->timestamp_ms[SYSVAR_ID_##name]);      \
+    if (generation != snapshot->generation[SYSVAR_ID_##name]) {           \
+      changed |= 1UL << SYSVAR_ID_##name;                                 \
+    }                                                                     \
+    snapshot->generation[SYSVAR_ID_##name] = generation;                  \
   }
+  SYSVAR_LIST(SYSVAR_COPY)
+#undef SYSVAR_COPY
+  sysvar_unlock();
+  snapshot->changed = changed;
+}
 
+// Access functions, never time out so always return 0
 int8_t sysvar_get_pico_temp_c(float* output) {
-  with_sysvar_mutex(*output = pico_temp_c);
+  sysvar_pico_temp_c.get(output);
+  return 0;
 }
 
 int8_t sysvar_set_pico_temp_c(float input) {
-  with_sysvar_mutex(pico_temp_c = input);
+  sysvar_pico_temp_c.set(input);
+  return 0;
 }
 
 int8_t sysvar_get_rtc_time(uint32_t* output) {
-  with_sysvar_mutex(*output = rtc_time);
+  sysvar_rtc_time.get(output);
+  return 0;
 }
 
 int8_t sysvar_set_rtc_time(uint32_t input) {
-  with_sysvar_mutex(rtc_time = input);
+  sysvar_rtc_time.set(input);
+  return 0;
 }
 
 int8_t sysvar_set_ina_data(INASensorData* ina_sensor_data) {
-  with_sysvar_mutex(ina_data = *ina_sensor_data);
+  sysvar_ina_data.set(*ina_sensor_data);
+  return 0;
 }
 
 int8_t sysvar_get_ina_data(INASensorData* ina_sensor_data) {
-  with_sysvar_mutex(*ina_sensor_data = ina_data);
+  sysvar_ina_data.get(ina_sensor_data);
+  return 0;
 }
 
 int8_t sysvar_set_bme_data(BMESensorData* sensor_data) {
-  with_sysvar_mutex(bme_data = *sensor_data);
+  sysvar_bme_data.set(*sensor_data);
+  return 0;
 }
 
 int8_t sysvar_get_bme_data(BMESensorData* sensor_data) {
-  with_sysvar_mutex(*sensor_data = bme_data);
+  sysvar_bme_data.get(sensor_data);
+  return 0;
 }
 
 int8_t sysvar_set_gps_data(GPSSensorData* sensor_data) {
-  with_sysvar_mutex(gps_data = *sensor_data);
+  sysvar_gps_data.set(*sensor_data);
+  return 0;
 }
 
 int8_t sysvar_get_gps_data(GPSSensorData* sensor_data) {
-  with_sysvar_mutex(*sensor_data = gps_data);
+  sysvar_gps_data.get(sensor_data);
+  return 0;
+}
+
+int8_t sysvar_set_rc_realtime(RCRealTimeValues* values) {
+  sysvar_rc_realtime.set(*values);
+  return 0;
+}
+
+int8_t sysvar_get_rc_realtime(RCRealTimeValues* values) {
+  sysvar_rc_realtime.get(values);
+  return 0;
 }
@@ -6,20 +6,48 @@
 
 GPSSensor::GPSSensor() : Sensor("GPS") {}
 
-GPSSensorData GPSSensorData::fromGnss(SFE_UBLOX_GNSS& gnss) {
+/**
+ * @brief Seconds since the Unix epoch of a NAV-PVT UTC date and time
+ *
+ * @param pvt NAV-PVT solution
+ * @return uint32_t
+ */
+static uint32_t unix_epoch(const UBX_NAV_PVT_data_t& pvt) {
+  // days since 1970-01-01 by the civil calendar, March based so leap days
+  // fall at the end of the year
+  uint32_t y = pvt.year - (pvt.month <= 2);
+  uint32_t era = y / 400;
+  uint32_t yoe = y - era * 400;
+  uint32_t doy =
+      (153 * (pvt.month > 2 ? pvt.month - 3 : pvt.month + 9) + 2) / 5 +
+      pvt.day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  uint32_t days = era * 146097 + doe - 719468;
+
+  return days * 86400 + pvt.hour * 3600 + pvt.min * 60 + pvt.sec;
+}
+
+/**
+ * @brief Copies the fields logged from a NAV-PVT solution
+ *
+ * @param pvt NAV-PVT solution
+ * @return GPSSensorData
+ */
+GPSSensorData GPSSensorData::fromPVT(const UBX_NAV_PVT_data_t& pvt) {
   GPSSensorData sensor_data;
-  sensor_data.unix_time_s = gnss.getUnixEpoch();
-  sensor_data.fix_type = gnss.getFixType();
-  sensor_data.fix_ok = gnss.getGnssFixOk();
-  sensor_data.siv = gnss.getSIV();
-  sensor_data.lat_e7 = gnss.getLatitude();
-  sensor_data.lon_e7 = gnss.getLongitude();
-  sensor_data.alt_msl_mm = gnss.getAltitudeMSL();
-  sensor_data.vel_n_mmps = gnss.getNedNorthVel();
-  sensor_data.vel_e_mmps = gnss.getNedEastVel();
-  sensor_data.vel_d_mmps = gnss.getNedDownVel();
-  sensor_data.hacc_mm = gnss.getHorizontalAccEst();
-  sensor_data.vacc_mm = gnss.getVerticalAccEst();
+  sensor_data.unix_time_s = unix_epoch(pvt);
+  sensor_data.fix_type = pvt.fixType;
+  sensor_data.fix_ok = pvt.flags.bits.gnssFixOK;
+  sensor_data.siv = pvt.numSV;
+  sensor_data.lat_e7 = pvt.lat;
+  sensor_data.lon_e7 = pvt.lon;
+  sensor_data.alt_msl_mm = pvt.hMSL;
+  sensor_data.vel_n_mmps = pvt.velN;
+  sensor_data.vel_e_mmps = pvt.velE;
+  sensor_data.vel_d_mmps = pvt.velD;
+  sensor_data.hacc_mm = pvt.hAcc;
+  sensor_data.vacc_mm = pvt.vAcc;
+  sensor_data.itow_ms = pvt.iTOW;
 
   return sensor_data;
 }
@@ -31,22 +59,33 @@ bool GPSSensor::verify() {
 
   // Keep I2C output clean and read compact UBX packets.
   gnss.setI2COutput(COM_TYPE_UBX);
-  gnss.setAutoPVT(true);
+  // a whole NAV-PVT per I2C read instead of 32 byte pieces
+  gnss.setI2CTransactionSize(GPS_I2C_TRANSACTION_SIZE);
+  gnss.setNavigationFrequency(GPS_NAV_RATE_HZ);
+  gnss.setAutoPVTcallbackPtr(&GPSSensor::onPVT);
   gnss.setDynamicModel(DYN_MODEL_AIRBORNE4g);
 
   return true;
 }
 
-void GPSSensor::readToSysVar() {
-  if (gnss.getPVT() == false) {
-    return;
-  }
-
-  if (gnss.getInvalidLlh()) {
+/**
+ * @brief Publishes a NAV-PVT solution, called by checkCallbacks from the
+ * sensors task
+ *
+ * @param pvt Library's copy of the latest solution
+ */
+void GPSSensor::onPVT(UBX_NAV_PVT_data_t* pvt) {
+  if (pvt->flags3.bits.invalidLlh) {
     return;
   }
 
-  GPSSensorData sensor_data = GPSSensorData::fromGnss(gnss);
+  GPSSensorData sensor_data = GPSSensorData::fromPVT(*pvt);
 
   sysvar_set_gps_data(&sensor_data);
 }
+
+void GPSSensor::readToSysVar() {
+  // never waits on the receiver, only reads what it already pushed
+  gnss.checkUblox();
+  gnss.checkCallbacks();
+}
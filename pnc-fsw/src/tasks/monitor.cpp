@@ -4,62 +4,102 @@
 #include <drivers/GPSSensor.h>
 #include <drivers/INASensor.h>
 
+#include "PnCLog.h"
 #include "SysHead.h"
 #include "tasks/watchdog.h"
 
-void monitor_task() {
-  watchdog_intertask_update(WATCHDOG_MONITOR_TASK_ID);
+#if MONITOR_BINARY_TELEMETRY
+/**
+ * @brief Writes every SysVar as one binary PnC record, preceded by the schema
+ * header every MONITOR_SCHEMA_INTERVAL records so a decoder can join at any
+ * time
+ *
+ * @param snapshot Latest snapshot
+ */
+static void send_telemetry(const SysVarSnapshot& snapshot) {
+  static PnCLog telemetry_log;
+  static uint8_t frame[PNC_LOG_HEADER_SIZE + PNC_RECORD_MAX_SIZE];
+  static uint32_t frames = 0;
+
+  size_t len = 0;
+  if (frames % MONITOR_SCHEMA_INTERVAL == 0) {
+    len = PnCLog::encode_header(frame);
+  }
+  telemetry_log.reset();
+  len += telemetry_log.encode(snapshot, millis(), frame + len);
+  frames++;
+
+  // one write so other cores' log lines can't split the frame
+  log_data_raw(frame, len);
+}
+#else
+/**
+ * @brief Logs every SysVar changed since the previous snapshot as text lines
+ *
+ * @param snapshot Snapshot reused between calls
+ */
+static void log_changed(const SysVarSnapshot& snapshot) {
+  if (snapshot.changed & (1UL << SYSVAR_ID_pico_temp_c)) {
+    log_task("Pico Temp: " + String(snapshot.pico_temp_c));
+  }
 
-  float pico_temp_c;
-  int8_t res = sysvar_get_pico_temp_c(&pico_temp_c);
+  if (snapshot.changed & (1UL << SYSVAR_ID_rtc_time)) {
+    log_task("RTC Time: " + String(snapshot.rtc_time));
+  }
 
-  log_task("Pico Temp: " + String(pico_temp_c) + "(" + String(res) + ")");
+  if (snapshot.changed & (1UL << SYSVAR_ID_bme_data)) {
+    const BMESensorData& bme_data = snapshot.bme_data;
+    log_task("BME Temperature: " + String(bme_data.BMETemp));
+    log_task("BME Pressure: " + String(bme_data.BMEPressure));
+    log_task("BME Humidity: " + String(bme_data.BMEHumidity));
+    log_task("BME Gas Sensor: " + String(bme_data.BMEGasResistance));
+  }
 
-  uint32_t rtc_time;
-  res = sysvar_get_rtc_time(&rtc_time);
-  log_task("RTC Time: " + String(rtc_time) + "(" + String(res) + ")");
+  if (snapshot.changed & (1UL << SYSVAR_ID_gps_data)) {
+    const GPSSensorData& gps_data = snapshot.gps_data;
+    log_task("GPS Unix Time: " + String(gps_data.unix_time_s));
+    log_task("GPS Fix Type: " + String(gps_data.fix_type));
+    log_task("GPS Fix OK: " + String(gps_data.fix_ok));
+    log_task("GPS SIV: " + String(gps_data.siv));
+    log_task("GPS Lat E7: " + String(gps_data.lat_e7));
+    log_task("GPS Lon E7: " + String(gps_data.lon_e7));
+    log_task("GPS Alt MSL mm: " + String(gps_data.alt_msl_mm));
+    log_task("GPS Vel N mmps: " + String(gps_data.vel_n_mmps));
+    log_task("GPS Vel E mmps: " + String(gps_data.vel_e_mmps));
+    log_task("GPS Vel D mmps: " + String(gps_data.vel_d_mmps));
+    log_task("GPS HAcc mm: " + String(gps_data.hacc_mm));
+    log_task("GPS VAcc mm: " + String(gps_data.vacc_mm));
+    log_task("GPS iTOW ms: " + String(gps_data.itow_ms));
+  }
 
-  BMESensorData bme_data;
-  res = sysvar_get_bme_data(&bme_data);
-  log_task("BME Temperature: " + String(bme_data.BMETemp) + "(" + String(res) +
-           ")");
-  log_task("BME Pressure: " + String(bme_data.BMEPressure) + "(" + String(res) +
-           ")");
-  log_task("BME Humidity: " + String(bme_data.BMEHumidity) + "(" + String(res) +
-           ")");
-  log_task("BME Gas Sensor: " + String(bme_data.BMEGasResistance) + "(" +
-           String(res) + ")");
+  if (snapshot.changed & (1UL << SYSVAR_ID_ina_data)) {
+    const INASensorData& ina_data = snapshot.ina_data;
+    log_task("INA Current: " + String(ina_data.INACurrent));
+    log_task("INA Bus Voltage: " + String(ina_data.INABusVoltage));
+    log_task("INA Power: " + String(ina_data.INAPower));
+  }
+
+  if (snapshot.changed & (1UL << SYSVAR_ID_rc_realtime)) {
+    const RCRealTimeValues& rc = snapshot.rc_realtime;
+    log_task("RC CPS: " + String(rc.count_rate_cps));
+    log_task("RC Dose Rate uR/h: " + String(rc.dose_rate_uR_h));
+    log_task("RC Dose uR: " + String(rc.dose_uR));
+    log_task("RC Temperature: " + String(rc.temperature_c));
+  }
+}
+#endif
+
+void monitor_task() {
+  watchdog_intertask_update(WATCHDOG_MONITOR_TASK_ID);
 
-  GPSSensorData gps_data;
-  res = sysvar_get_gps_data(&gps_data);
-  log_task("GPS Unix Time: " + String(gps_data.unix_time_s) + "(" +
-           String(res) + ")");
-  log_task("GPS Fix Type: " + String(gps_data.fix_type) + "(" + String(res) +
-           ")");
-  log_task("GPS Fix OK: " + String(gps_data.fix_ok) + "(" + String(res) + ")");
-  log_task("GPS SIV: " + String(gps_data.siv) + "(" + String(res) + ")");
-  log_task("GPS Lat E7: " + String(gps_data.lat_e7) + "(" + String(res) + ")");
-  log_task("GPS Lon E7: " + String(gps_data.lon_e7) + "(" + String(res) + ")");
-  log_task("GPS Alt MSL mm: " + String(gps_data.alt_msl_mm) + "(" +
-           String(res) + ")");
-  log_task("GPS Vel N mmps: " + String(gps_data.vel_n_mmps) + "(" +
-           String(res) + ")");
-  log_task("GPS Vel E mmps: " + String(gps_data.vel_e_mmps) + "(" +
-           String(res) + ")");
-  log_task("GPS Vel D mmps: " + String(gps_data.vel_d_mmps) + "(" +
-           String(res) + ")");
-  log_task("GPS HAcc mm: " + String(gps_data.hacc_mm) + "(" + String(res) +
-           ")");
-  log_task("GPS VAcc mm: " + String(gps_data.vacc_mm) + "(" + String(res) +
-           ")");
+  static SysVarSnapshot snapshot;
+  sysvar_snapshot(&snapshot);
 
-  INASensorData ina_data;
-  res = sysvar_get_ina_data(&ina_data);
-  log_task("INA Current: " + String(ina_data.INACurrent) + "(" + String(res) +
-           ")");
-  log_task("INA Bus Voltage: " + String(ina_data.INABusVoltage) + "(" +
-           String(res) + ")");
-  log_task("INA Power: " + String(ina_data.INAPower) + "(" + String(res) + ")");
+#if MONITOR_BINARY_TELEMETRY
+  send_telemetry(snapshot);
+#else
+  log_changed(snapshot);
+#endif
 }
 
 void monitor_task_init() {
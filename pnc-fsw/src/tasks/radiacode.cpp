@@ -0,0 +1,409 @@
+#include "tasks/radiacode.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "RadiacodeBLE.h"
+#include "SpectrumLog.h"
+#include "SysHead.h"
+#include "tasks/storage.h"
+#include "tasks/watchdog.h"
+
+static String rc_target_mac = "52:43:06:60:17:DD";
+
+// to not be on stack
+static int spectrum[RC_SPECTRUM_CHANNELS];
+static SpectrumLog spectrum_log(SPECTRUM_KEYFRAME_INTERVAL);
+static uint8_t spectrum_record[SPECTRUM_RECORD_MAX_SIZE];
+static uint8_t data_records[RC_RECORD_BUFFER_SIZE];
+
+// consecutive failed requests, the link is restarted past RC_MAX_FAILS
+static uint8_t fails = 0;
+// spectrum holds a full SPECTRUM plus every SPEC_DIFF since
+static bool have_baseline = false;
+static uint16_t diffs_since_baseline = 0;
+
+// adaptive DATA_BUF poll, see adapt_data_buf_interval
+static uint32_t data_buf_interval_ms = RC_DATA_BUF_POLL_MIN_MS;
+static uint32_t last_data_buf = 0;
+static uint32_t data_buf_polls = 0;  // since the last stats log
+static uint32_t data_buf_events = 0;
+static uint32_t data_buf_dropped = 0;  // events whose records storage dropped
+static uint32_t spectra_dropped = 0;
+
+typedef enum {
+  RC_LINK_WAIT,      // backing off before the next attempt
+  RC_LINK_FIND,      // scan and connect
+  RC_LINK_DISCOVER,  // service discovery and notifications
+  RC_LINK_EXCHANGE,  // SET_EXCHANGE
+  RC_LINK_UP
+} RCLinkState;
+
+static RCLinkState link_state = RC_LINK_FIND;
+static uint32_t link_retry_at = 0;
+static uint32_t link_backoff_ms = RC_RECONNECT_BACKOFF_MIN_MS;
+static uint32_t link_down_since = 0;
+static uint32_t link_attempt_start = 0;
+static uint16_t link_attempts = 0;
+
+/**
+ * @brief Drops the connection and starts reconnecting without a reboot
+ *
+ * @param reason Logged cause
+ */
+static void radiacode_link_lost(const char* reason) {
+  log_task_printf("RadiaCode link lost: %s\n", reason);
+  radiacode_ble_disconnect();
+  link_state = RC_LINK_WAIT;
+  link_retry_at = millis();
+  link_backoff_ms = RC_RECONNECT_BACKOFF_MIN_MS;
+  link_down_since = millis();
+  link_attempts = 0;
+  fails = 0;
+}
+
+/**
+ * @brief Backs off after a failed connection step
+ *
+ */
+static void radiacode_link_retry(const char* step, uint8_t res) {
+  log_task_printf("RadiaCode %s failed (%u), retry %u in %lu ms\n", step, res,
+                  link_attempts, link_backoff_ms);
+  radiacode_ble_disconnect();
+  link_state = RC_LINK_WAIT;
+  link_retry_at = millis() + link_backoff_ms;
+  link_backoff_ms *= 2;
+  if (link_backoff_ms > RC_RECONNECT_BACKOFF_MAX_MS) {
+    link_backoff_ms = RC_RECONNECT_BACKOFF_MAX_MS;
+  }
+}
+
+/**
+ * @brief Runs one step of connecting to the RadiaCode, so every step gets
+ * its own task period and watchdog heartbeat
+ *
+ * @return true if the link is up
+ * @return false while connecting
+ */
+static bool radiacode_link_step() {
+  uint8_t res;
+  switch (link_state) {
+    case RC_LINK_UP:
+      if (radiacode_ble_connected()) return true;
+      radiacode_link_lost("disconnected");
+      return false;
+
+    case RC_LINK_WAIT:
+      if ((int32_t)(millis() - link_retry_at) >= 0) link_state = RC_LINK_FIND;
+      return false;
+
+    case RC_LINK_FIND:
+      link_attempts++;
+      link_attempt_start = millis();
+      res = radiacode_ble_find(rc_target_mac, true);
+      if (res != 0) {
+        radiacode_link_retry("scan", res);
+      } else {
+        link_state = RC_LINK_DISCOVER;
+      }
+      return false;
+
+    case RC_LINK_DISCOVER:
+      res = radiacode_ble_discover(true);
+      if (res != 0) {
+        radiacode_link_retry("discovery", res);
+      } else {
+        link_state = RC_LINK_EXCHANGE;
+      }
+      return false;
+
+    case RC_LINK_EXCHANGE:
+      res = radiacode_ble_exchange();
+      if (res != 0) {
+        radiacode_link_retry("exchange", res);
+        return false;
+      }
+      log_task_printf(
+          "RadiaCode connected in %lu ms after %u attempts, outage %lu ms\n",
+          millis() - link_attempt_start, link_attempts,
+          millis() - link_down_since);
+      link_state = RC_LINK_UP;
+      link_backoff_ms = RC_RECONNECT_BACKOFF_MIN_MS;
+      link_attempts = 0;
+      // counts may have been missed while disconnected
+      have_baseline = false;
+      // and the device buffered events meanwhile
+      data_buf_interval_ms = RC_DATA_BUF_POLL_MIN_MS;
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Converts a DATA_BUF response to binary records and queues them for
+ * the rc file
+ *
+ * @param r DATA_BUF response
+ * @return size_t Number of events read
+ */
+static size_t store_data_buf(BytesBuffer* r) {
+  uint32_t now = millis();
+  size_t events = 0;
+  size_t used = 0;
+  size_t batched = 0;  // events in data_records
+  while (r->size() >= 7) {
+    DataPoint d = consume_data_buf(r);
+    events++;
+    batched++;
+
+#if RC_LOG_DATA_POINTS
+    std::visit(
+        [now](const auto& v) {
+          char str[500];
+          v.to_string(str, 500);
+          log_task_printf("%lu,%s\n", now, str);
+        },
+        d);
+#endif
+
+    used += data_point_to_record(d, now, data_records + used);
+    if (sizeof(data_records) - used < DATA_POINT_RECORD_MAX_SIZE) {
+      if (!storage_write(STORAGE_FILE_RC, data_records, used)) {
+        data_buf_dropped += batched;
+      }
+      used = 0;
+      batched = 0;
+    }
+  }
+  if (used > 0 && !storage_write(STORAGE_FILE_RC, data_records, used)) {
+    data_buf_dropped += batched;
+  }
+  return events;
+}
+
+/**
+ * @brief Picks the next DATA_BUF poll interval so a read returns about
+ * RC_DATA_BUF_TARGET_BYTES at the rate the last one saw
+ *
+ * @param bytes Size of the last DATA_BUF response
+ * @param elapsed_ms Time the response accumulated over
+ */
+static void adapt_data_buf_interval(size_t bytes, uint32_t elapsed_ms) {
+  // after an outage the backlog says more about the rate than the outage
+  if (elapsed_ms > RC_DATA_BUF_POLL_MAX_MS) {
+    elapsed_ms = RC_DATA_BUF_POLL_MAX_MS;
+  }
+
+  uint32_t next = RC_DATA_BUF_POLL_MAX_MS;
+  if (bytes > 0) {
+    next = (uint64_t)RC_DATA_BUF_TARGET_BYTES * elapsed_ms / bytes;
+  }
+  // speed up at once so a burst can't overflow the device's buffer, slow
+  // down gradually
+  if (next > data_buf_interval_ms) next = (data_buf_interval_ms + next) / 2;
+  if (next < RC_DATA_BUF_POLL_MIN_MS) next = RC_DATA_BUF_POLL_MIN_MS;
+  if (next > RC_DATA_BUF_POLL_MAX_MS) next = RC_DATA_BUF_POLL_MAX_MS;
+  data_buf_interval_ms = next;
+}
+
+/**
+ * @brief Logs the BLE round trip time and throughput every
+ * RC_STATS_LOG_PERIOD_MS
+ *
+ */
+static void log_ble_stats() {
+  static uint32_t last_log = 0;
+  uint32_t now = millis();
+  uint32_t elapsed = now - last_log;
+  if (elapsed < RC_STATS_LOG_PERIOD_MS) return;
+  last_log = now;
+
+  RCBleStats stats;
+  rc_ble_get_stats(&stats, true);
+  uint32_t rtt_avg_us =
+      stats.requests > 0 ? stats.rtt_total_us / stats.requests : 0;
+  log_task_printf(
+      "BLE: %lu req, %lu failed, rtt avg %lu us max %lu us, rx %lu B/s in "
+      "%lu notifies, tx %lu B in %lu writes of %u %s response\n",
+      stats.requests, stats.failures, rtt_avg_us, stats.rtt_max_us,
+      (uint32_t)((uint64_t)stats.bytes_received * 1000 / elapsed),
+      stats.notifications, stats.bytes_sent, stats.writes,
+      rc_ble_chunk_size(),
+      rc_ble_writes_without_response() ? "without" : "with");
+  log_task_printf(
+      "DATA_BUF: %lu polls, %lu events, %lu dropped, interval %lu ms\n",
+      data_buf_polls, data_buf_events, data_buf_dropped,
+      data_buf_interval_ms);
+  if (spectra_dropped > 0) {
+    log_task_printf("Spectrum: %lu records dropped\n", spectra_dropped);
+  }
+  data_buf_polls = 0;
+  data_buf_events = 0;
+  data_buf_dropped = 0;
+  spectra_dropped = 0;
+}
+
+/**
+ * @brief Publishes a RC_REALTIME_VSFRS batch read to SysVar
+ *
+ * @return false if the RadiaCode did not answer
+ */
+static bool store_realtime_vsfrs(int vsfr_req) {
+  uint32_t raw[RC_REALTIME_VSFR_COUNT];
+  uint8_t res = read_vsfr_batch_wait(vsfr_req, RC_REALTIME_VSFR_COUNT, raw);
+  rc_request_release(vsfr_req);
+  if (res != 0) {
+    log_task_printf("VSFR batch failed (%u)\n", res);
+    return res != 1;
+  }
+
+  RCRealTimeValues values;
+  decode_realtime_vsfrs(raw, &values);
+  sysvar_set_rc_realtime(&values);
+  return true;
+}
+
+static void save_radiacode_data() {
+  static uint32_t last_spectrum = 0;
+  static uint32_t last_vsfr = 0;
+
+  log_task("save_radiacode_data");
+
+  if (fails > RC_MAX_FAILS) {
+    radiacode_link_lost("too many failed requests");
+    return;
+  }
+
+  bool spectrum_due = millis() - last_spectrum > SPECTRUM_PERIOD_MS;
+  bool baseline = !have_baseline ||
+                  diffs_since_baseline >= SPECTRUM_BASELINE_INTERVAL;
+
+  // send every due request before waiting so the spectrum transfer overlaps
+  // processing the event data
+  int reset_req = -1;
+  int spec_req = -1;
+  if (spectrum_due) {
+    log_task(baseline ? "Reading spectrum" : "Reading spectrum diff");
+    last_spectrum = millis();
+    if (baseline) {
+      // restart the device's diff and read the full spectrum in one write,
+      // so only the device's handling of the reset lies between them for
+      // the next SPEC_DIFF to count twice
+      const uint32_t ids[2] = {VS::SPEC_DIFF, VS::SPECTRUM};
+      int handles[2];
+      if (read_requests_async(ids, 2, handles)) {
+        reset_req = handles[0];
+        spec_req = handles[1];
+      }
+    } else {
+      spec_req = read_request_async(VS::SPEC_DIFF);
+    }
+  }
+  int data_req = -1;
+  uint32_t data_buf_elapsed = millis() - last_data_buf;
+  if (data_buf_elapsed >= data_buf_interval_ms) {
+    last_data_buf = millis();
+    data_req = read_request_async(VS::DATA_BUF);
+    data_buf_polls++;
+  }
+  int vsfr_req = -1;
+  if (millis() - last_vsfr >= RC_VSFR_PERIOD_MS) {
+    last_vsfr = millis();
+    vsfr_req =
+        read_vsfr_batch_async(RC_REALTIME_VSFRS, RC_REALTIME_VSFR_COUNT);
+  }
+
+  // get event data
+  if (data_req >= 0) {
+    BytesBuffer* r = read_request_wait(data_req);
+
+    if (r == nullptr) {
+      fails++;
+    } else {
+      fails = 0;
+      adapt_data_buf_interval(r->size(), data_buf_elapsed);
+      size_t events = store_data_buf(r);
+      data_buf_events += events;
+      log_task_printf("DATA_BUF: %u events\n", events);
+    }
+    rc_request_release(data_req);
+  }
+
+  if (vsfr_req >= 0 && !store_realtime_vsfrs(vsfr_req)) fails++;
+
+  if (reset_req >= 0) {
+    bool reset = read_request_wait(reset_req) != nullptr;
+    rc_request_release(reset_req);
+    if (!reset) {
+      // the next SPEC_DIFF may not be relative to the spectrum
+      rc_request_release(spec_req);
+      fails++;
+      return;
+    }
+  }
+
+  if (spec_req >= 0) {
+    BytesBuffer* spec_buf = read_request_wait(spec_req);
+
+    if (spec_buf == nullptr) {
+      rc_request_release(spec_req);
+      have_baseline = false;  // a missed diff leaves the sum short
+      fails++;
+      return;
+    }
+
+    float a0, a1, a2;
+    uint32_t ts;
+    uint8_t res =
+        baseline ? decode_spectrum(spec_buf, spectrum, a0, a1, a2, ts)
+                 : accumulate_spectrum(spec_buf, spectrum, a0, a1, a2, ts);
+    rc_request_release(spec_req);
+    if (res != 0) {
+      have_baseline = false;
+      fails++;
+      return;
+    }
+    if (baseline) {
+      have_baseline = true;
+      diffs_since_baseline = 0;
+    } else {
+      diffs_since_baseline++;
+    }
+
+    size_t len = spectrum_log.encode(spectrum, RC_SPECTRUM_CHANNELS, ts, a0,
+                                     a1, a2, spectrum_record);
+    log_task_printf("a0: %f, a1: %f, a2: %f, ts: %u, record: %u bytes\n", a0,
+                    a1, a2, ts, len);
+
+    // the next delta can't be decoded without this record
+    if (!storage_write(STORAGE_FILE_SPEC, spectrum_record, len)) {
+      spectrum_log.reset();
+      spectra_dropped++;
+    }
+  }
+}
+
+static void radiacode_task(void* params) {
+  TickType_t last_wake = xTaskGetTickCount();
+  while (1) {
+    watchdog_intertask_update(WATCHDOG_RADIACODE_TASK_ID);
+    if (radiacode_link_step()) save_radiacode_data();
+    log_ble_stats();
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(RADIACODE_TASK_PERIOD_MS));
+  }
+}
+
+void radiacode_setup() {
+  // the RadiaCode task connects, so a missing RadiaCode can't hold up setup
+  radiacode_ble_init();
+  link_down_since = millis();
+}
+
+void radiacode_task_init() {
+  TaskHandle_t handle;
+  xTaskCreate(radiacode_task, "radiacode", RADIACODE_TASK_STACK_WORDS, nullptr,
+              RADIACODE_TASK_PRIORITY, &handle);
+  vTaskCoreAffinitySet(handle, 1 << 0);
+
+  log_task("RadiaCode task started.");
+}
@@ -0,0 +1,93 @@
+#include "tasks/sensors.h"
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include "PnCLog.h"
+#include "SysHead.h"
+#include "tasks/storage.h"
+#include "tasks/watchdog.h"
+
+// sensors
+#include "drivers/BMESensor.h"
+#include "drivers/GPSSensor.h"
+#include "drivers/INASensor.h"
+#include "drivers/PicoTempSensor.h"
+#include "drivers/RTCSensor.h"
+#include "drivers/Sensor.h"
+
+static PicoTempSensor pico_temp_sensor;
+static RTCSensor rtc_sensor;
+static BMESensor bme_sensor;
+static GPSSensor gps_sensor;
+static INASensor ina_sensor;
+
+static Sensor* sensors[] = {&pico_temp_sensor, &rtc_sensor, &bme_sensor,
+                            &ina_sensor, &gps_sensor};
+static const size_t sensors_len = sizeof(sensors) / sizeof(sensors[0]);
+static bool found_sensors[sensors_len];
+
+static void sysvar_update() {
+  // update pico temp
+  log_task("Starting SysVar Update...");
+
+  for (int i = 0; i < sensors_len; i++) {
+    if (found_sensors[i]) {
+      sensors[i]->readToSysVar();
+    }
+  }
+
+  log_task("Done.");
+}
+
+/**
+ * @brief Queues a record of the SysVar groups written since the previous one
+ * for the data file
+ *
+ */
+static void record_sysvars() {
+  static SysVarSnapshot snapshot;
+  static PnCLog pnc_log;
+  static uint8_t record[PNC_RECORD_MAX_SIZE];
+
+  // one consistent copy of every variable
+  sysvar_snapshot(&snapshot);
+  size_t len = pnc_log.encode(snapshot, millis(), record);
+
+  // groups changed in a record that isn't stored go in the next full one
+  if (len > 0 && !storage_write(STORAGE_FILE_DATA, record, len)) {
+    pnc_log.reset();
+  }
+}
+
+static void sensors_task(void* params) {
+  TickType_t last_wake = xTaskGetTickCount();
+  while (1) {
+    watchdog_intertask_update(WATCHDOG_SENSORS_TASK_ID);
+    sysvar_update();
+    record_sysvars();
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(SENSORS_TASK_PERIOD_MS));
+  }
+}
+
+void sensors_setup() {
+  for (int i = 0; i < sensors_len; i++) {
+    log_task("Verifying " + sensors[i]->getSensorName() + "...");
+    if (sensors[i]->verify()) {
+      found_sensors[i] = true;
+      log_task("Success.");
+    } else {
+      found_sensors[i] = false;
+      log_task("Failure.");
+    }
+  }
+}
+
+void sensors_task_init() {
+  TaskHandle_t handle;
+  xTaskCreate(sensors_task, "sensors", SENSORS_TASK_STACK_WORDS, nullptr,
+              SENSORS_TASK_PRIORITY, &handle);
+  vTaskCoreAffinitySet(handle, 1 << 0);
+
+  log_task("Sensors task started.");
+}
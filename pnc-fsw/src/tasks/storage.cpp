@@ -0,0 +1,263 @@
+#include "tasks/storage.h"
+
+#include <FreeRTOS.h>
+#include <SD.h>
+#include <semphr.h>
+#include <stream_buffer.h>
+#include <task.h>
+
+#include <atomic>
+
+#include "PnCLog.h"
+#include "SysHead.h"
+#include "tasks/watchdog.h"
+
+/**
+ * @brief One file of this boot and the write-behind buffer feeding it
+ *
+ */
+struct StorageStream {
+  const char* prefix;
+  size_t buffer_size;
+  StreamBufferHandle_t buffer;  // filled by one task, drained by storage
+  SemaphoreHandle_t mutex;      // held to queue a record or discard the queue
+  std::atomic<bool> lost;       // bytes lost, not yet reported by storage_write
+  File file;
+};
+
+static void sd_setup();
+static void sd_fail();
+static bool drain(StorageStream& stream, bool sync);
+static int next_file_number();
+static int scan_file_number();
+static void save_boot_count(int next_num);
+
+static StorageStream streams[STORAGE_FILE_COUNT] = {
+    {"data", STORAGE_DATA_BUFFER_SIZE},
+    {"rc", STORAGE_RC_BUFFER_SIZE},
+    {"spec", STORAGE_SPEC_BUFFER_SIZE}};
+
+// only touched by the storage task after storage_setup
+static bool sd_status = false;
+static int file_number = -1;
+static bool boot_count_saved = false;
+
+/**
+ * @brief Starts the SD card and opens every file of this boot, appending
+ * after a transient failure
+ *
+ */
+static void sd_setup() {
+  if (!SD.begin(SD_PIN)) {
+    ErrorDisplay::instance().addCode(Error::SD_CARD_FAIL);
+    return;
+  }
+
+  if (file_number < 0) file_number = next_file_number();
+
+  for (StorageStream& stream : streams) {
+    String filename = String(stream.prefix) + String(file_number) + ".bin";
+    stream.file = SD.open(filename, FILE_WRITE);
+    if (!stream.file) {
+      sd_fail();
+      return;
+    }
+    log_task("Saving to " + filename);
+  }
+
+  // decoders need the schema before the first record
+  File& data = streams[STORAGE_FILE_DATA].file;
+  if (data.size() == 0) {
+    uint8_t header[PNC_LOG_HEADER_SIZE];
+    size_t len = PnCLog::encode_header(header);
+    if (data.write(header, len) != len) {
+      sd_fail();
+      return;
+    }
+  }
+
+  sd_status = true;
+  if (!boot_count_saved) {
+    save_boot_count(file_number + 1);
+    boot_count_saved = true;
+  }
+}
+
+/**
+ * @brief Closes every file and the SD card, if they were in use the queued
+ * records are discarded and the next record of every file must stand on its
+ * own
+ *
+ */
+static void sd_fail() {
+  ErrorDisplay::instance().addCode(Error::SD_CARD_FAIL);
+  log_task("SD card failed, closing files");
+  for (StorageStream& stream : streams) {
+    stream.file.close();
+    if (!sd_status) continue;
+
+    // unsynced bytes may not have made it, so queued records may depend on
+    // ones that never reached the card
+    xSemaphoreTake(stream.mutex, portMAX_DELAY);
+    stream.lost = true;
+    xStreamBufferReset(stream.buffer);
+    xSemaphoreGive(stream.mutex);
+  }
+  sd_status = false;
+  SD.end();
+}
+
+/**
+ * @brief Writes the buffered bytes of one file to the SD card
+ *
+ * @param stream File to drain
+ * @param sync Also write a partial chunk and flush the file
+ * @return true if every write succeeded
+ * @return false otherwise
+ */
+static bool drain(StorageStream& stream, bool sync) {
+  static uint8_t chunk[STORAGE_WRITE_CHUNK];
+
+  // whole sectors between syncs keep the card from rewriting partial ones
+  size_t min_bytes = sync ? 1 : sizeof(chunk);
+  while (xStreamBufferBytesAvailable(stream.buffer) >= min_bytes) {
+    size_t len = xStreamBufferReceive(stream.buffer, chunk, sizeof(chunk), 0);
+    if (stream.file.write(chunk, len) != len) return false;
+  }
+  if (sync) stream.file.flush();
+  return true;
+}
+
+/**
+ * @brief Gets the number of the next data/rc files from the boot count file,
+ * falling back to a single directory scan if it is missing or stale
+ *
+ * @return int Unused file number
+ */
+static int next_file_number() {
+  File count_file = SD.open(SD_BOOT_COUNT_FILE, FILE_READ);
+  if (count_file) {
+    char text[12] = {0};
+    count_file.read((uint8_t*)text, sizeof(text) - 1);
+    count_file.close();
+
+    char* end;
+    long num = strtol(text, &end, 10);
+    // a crash between creating the files and saving the count leaves it stale
+    if (end != text && num >= 0 && !SD.exists("data" + String(num) + ".bin")) {
+      return num;
+    }
+  }
+
+  log_task("Boot count missing or stale, scanning files");
+  return scan_file_number();
+}
+
+/**
+ * @brief Finds the number after the highest numbered data file in one pass
+ * over the root directory
+ *
+ * @return int Unused file number
+ */
+static int scan_file_number() {
+  int next_num = 0;
+
+  File root = SD.open("/");
+  if (!root) return 0;
+  File entry = root.openNextFile();
+  while (entry) {
+    const char* name = entry.name();
+    if (!entry.isDirectory() && strncasecmp(name, "data", 4) == 0 &&
+        isdigit(name[4])) {
+      char* end;
+      long num = strtol(name + 4, &end, 10);
+      if (strcasecmp(end, ".bin") == 0 && num >= next_num) next_num = num + 1;
+    }
+    entry.close();
+    entry = root.openNextFile();
+  }
+  root.close();
+  return next_num;
+}
+
+/**
+ * @brief Saves the number of the next data/rc files for the next boot
+ *
+ * @param next_num Number the next boot should use
+ */
+static void save_boot_count(int next_num) {
+  SD.remove(SD_BOOT_COUNT_FILE);
+  File count_file = SD.open(SD_BOOT_COUNT_FILE, FILE_WRITE);
+  if (!count_file) {
+    log_task("Failed to save boot count");
+    return;
+  }
+  count_file.println(next_num);
+  count_file.close();
+}
+
+/**
+ * @brief Queues a whole record for a file, to be written by the storage task
+ *
+ * Only one task may write each file. Records are kept while the SD card is
+ * down, until the buffer fills, but a failed write discards every record
+ * still queued.
+ *
+ * @param file File to append to
+ * @param data Record bytes
+ * @param len Record length
+ * @return true if queued
+ * @return false if the record was dropped, either for lack of space or
+ * because earlier bytes were lost or are being discarded, so the next record
+ * must not depend on the ones before it
+ */
+bool storage_write(StorageFile file, const uint8_t* data, size_t len) {
+  StorageStream& stream = streams[file];
+  // a record queued while sd_fail discards could outlive its base
+  if (xSemaphoreTake(stream.mutex, 0) != pdTRUE) return false;
+  bool queued = !stream.lost.exchange(false) &&
+                xStreamBufferSpacesAvailable(stream.buffer) >= len;
+  if (queued) xStreamBufferSend(stream.buffer, data, len, 0);
+  xSemaphoreGive(stream.mutex);
+  return queued;
+}
+
+static void storage_task(void* params) {
+  TickType_t last_wake = xTaskGetTickCount();
+  uint32_t last_sync = millis();
+  while (1) {
+    watchdog_intertask_update(WATCHDOG_STORAGE_TASK_ID);
+
+    if (!sd_status) sd_setup();
+    if (sd_status) {
+      bool sync = millis() - last_sync >= STORAGE_SYNC_PERIOD_MS;
+      if (sync) last_sync = millis();
+      for (StorageStream& stream : streams) {
+        if (!drain(stream, sync)) {
+          sd_fail();
+          break;
+        }
+      }
+    }
+
+    vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(STORAGE_TASK_PERIOD_MS));
+  }
+}
+
+void storage_setup() {
+  for (StorageStream& stream : streams) {
+    stream.buffer = xStreamBufferCreate(stream.buffer_size, 1);
+    stream.mutex = xSemaphoreCreateMutex();
+  }
+  sd_setup();
+}
+
+void storage_task_init() {
+  TaskHandle_t handle;
+  xTaskCreate(storage_task, "storage", STORAGE_TASK_STACK_WORDS, nullptr,
+              STORAGE_TASK_PRIORITY, &handle);
+  // SD card time stays off the core running sensors and the RadiaCode
+  vTaskCoreAffinitySet(handle, 1 << 1);
+
+  log_task("Storage task started.");
+}
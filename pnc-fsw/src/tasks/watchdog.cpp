@@ -6,7 +6,7 @@
 
 #define WATCHDOG_INTERVAL_MS 5000
 
-#define WATCHDOG_CONNECTED_TASKS 2
+#define WATCHDOG_CONNECTED_TASKS 4
 #define WATCHDOG_INTERTASK_CHECK_PERIOD_MS 1000 * 60  // 1 minute
 
 #if WATCHDOG_CONNECTED_TASKS > 0
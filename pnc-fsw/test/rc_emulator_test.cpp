@@ -0,0 +1,243 @@
+// Runs RadiaCodeBLELib requests against RCEmulator: spectrum and SPEC_DIFF
+// reassembly at any notification size, DATA_BUF events, VSFR batches, faults
+// and a replayed rc log. Build and run with make -C pnc-fsw/test
+
+#include <fstream>
+#include <string>
+
+#include "RCEmulator.h"
+#include "RadiacodeBLE.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                     \
+  do {                                                       \
+    if (!(cond)) {                                           \
+      printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+      printf(__VA_ARGS__);                                   \
+      printf("\n");                                          \
+      failures++;                                            \
+    }                                                        \
+  } while (0)
+
+static RCEmulator emulator;
+
+static void test_spectrum() {
+  int truth[RC_SPECTRUM_CHANNELS];
+  int got[RC_SPECTRUM_CHANNELS];
+  for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) {
+    truth[i] = (i % 7 == 0) ? 0 : (rand() % 300) * (i < 50 ? 200 : 1);
+  }
+  emulator.set_spectrum(truth, RC_SPECTRUM_CHANNELS, 42, 1.5f, 2.5f, 0.001f);
+
+  const size_t notify_sizes[] = {1, 2, 3, 5, 20, 244, 5000};
+  for (size_t notify_size : notify_sizes) {
+    emulator.set_notify_size(notify_size);
+    BytesBuffer* r = readSpectrumData();
+    CHECK(r != nullptr, "no spectrum at notify size %zu", notify_size);
+    if (r == nullptr) continue;
+    float a0, a1, a2;
+    uint32_t ts;
+    CHECK(decode_spectrum(r, got, a0, a1, a2, ts) == 0, "decode");
+    CHECK(ts == 42 && a0 == 1.5f, "header at notify size %zu", notify_size);
+    CHECK(memcmp(got, truth, sizeof(truth)) == 0, "counts at notify size %zu",
+          notify_size);
+  }
+
+  // the first SPEC_DIFF restarts the device's diff
+  emulator.set_notify_size(20);
+  CHECK(readSpectrumDiff() != nullptr, "diff reset");
+  int sum[RC_SPECTRUM_CHANNELS];
+  memcpy(sum, truth, sizeof(sum));
+  for (int k = 0; k < 5; k++) {
+    for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) truth[i] += rand() % 3;
+    emulator.set_spectrum(truth, RC_SPECTRUM_CHANNELS, 43 + k, 1.5f, 2.5f,
+                          0.001f);
+    BytesBuffer* r = readSpectrumDiff();
+    float a0, a1, a2;
+    uint32_t ts;
+    CHECK(r != nullptr && accumulate_spectrum(r, sum, a0, a1, a2, ts) == 0,
+          "diff %d", k);
+  }
+  CHECK(memcmp(sum, truth, sizeof(sum)) == 0, "diffs don't sum to spectrum");
+
+  // a baseline sends the reset and the spectrum in one write, the second
+  // request starts in the first chunk
+  for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) truth[i] += rand() % 3;
+  emulator.set_spectrum(truth, RC_SPECTRUM_CHANNELS, 50, 1.5f, 2.5f, 0.001f);
+  const uint32_t ids[RC_MAX_PENDING + 1] = {VS::SPEC_DIFF, VS::SPECTRUM};
+  int handles[RC_MAX_PENDING + 1];
+  CHECK(!read_requests_async(ids, RC_MAX_PENDING + 1, handles),
+        "more reads than request slots");
+  CHECK(read_requests_async(ids, 2, handles), "baseline not sent");
+  CHECK(read_request_wait(handles[0]) != nullptr, "baseline reset");
+  BytesBuffer* r = read_request_wait(handles[1]);
+  float a0, a1, a2;
+  uint32_t ts;
+  CHECK(r != nullptr && decode_spectrum(r, sum, a0, a1, a2, ts) == 0 &&
+            ts == 50,
+        "baseline spectrum");
+  rc_request_release(handles[0]);
+  rc_request_release(handles[1]);
+  for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) truth[i] += rand() % 3;
+  emulator.set_spectrum(truth, RC_SPECTRUM_CHANNELS, 51, 1.5f, 2.5f, 0.001f);
+  r = readSpectrumDiff();
+  CHECK(r != nullptr && accumulate_spectrum(r, sum, a0, a1, a2, ts) == 0,
+        "diff after the baseline");
+  CHECK(memcmp(sum, truth, sizeof(sum)) == 0,
+        "diff after the baseline counts twice");
+}
+
+static void test_events() {
+  emulator.queue_event(RealTimeData{1230, 7.5f, 0.00001f, 43, 177, 64, 0});
+  emulator.queue_event(RareData{4560, 417514, 0.00234f, 4765, 9278, 4160});
+  emulator.queue_event(Event{7890, 1, 2, 3});
+  emulator.queue_event(RawDoseRate{100, 2.5f, 9});
+  emulator.queue_event(RawCountRate{110, 3.5f, 8});
+
+  // pipelined with a spectrum
+  int data_req = read_request_async(VS::DATA_BUF);
+  int spec_req = read_request_async(VS::SPECTRUM);
+  BytesBuffer* r = read_request_wait(data_req);
+  CHECK(r != nullptr, "no DATA_BUF");
+  if (r != nullptr) {
+    DataPoint d = consume_data_buf(r);
+    CHECK(std::get<RealTimeData>(d).dt == 1230 &&
+              std::get<RealTimeData>(d).dose_rate_err == 177,
+          "RealTimeData");
+    d = consume_data_buf(r);
+    CHECK(std::get<RareData>(d).duration == 417514, "RareData");
+    d = consume_data_buf(r);
+    CHECK(std::get<Event>(d).flags == 3, "Event");
+    d = consume_data_buf(r);
+    CHECK(std::get<RawDoseRate>(d).flags == 9, "RawDoseRate");
+    d = consume_data_buf(r);
+    CHECK(std::get<RawCountRate>(d).flags == 8, "RawCountRate");
+    CHECK(r->empty(), "%zu bytes left", r->size());
+  }
+  rc_request_release(data_req);
+  CHECK(read_request_wait(spec_req) != nullptr, "no pipelined spectrum");
+  rc_request_release(spec_req);
+
+  r = read_request(VS::DATA_BUF);
+  CHECK(r != nullptr && r->empty(), "empty DATA_BUF is a success");
+  uint8_t on = 1;
+  CHECK(write_request(VSFR::DEVICE_ON, &on, 1) == 0, "write");
+}
+
+static void test_vsfr_batch() {
+  float temperature = 23.5f;
+  uint32_t temperature_word;
+  memcpy(&temperature_word, &temperature, sizeof(temperature_word));
+  emulator.set_vsfr(VSFR::CPS, 12);
+  emulator.set_vsfr(VSFR::DR_uR_h, 15);
+  emulator.set_vsfr(VSFR::DS_uR, 99);
+  emulator.set_vsfr(VSFR::TEMP_degC, temperature_word);
+  emulator.set_vsfr(VSFR::ACC_X, (uint32_t)(uint16_t)-5 << 16);
+  emulator.set_vsfr(VSFR::ACC_Y, 7u << 16);
+
+  uint32_t raw[RC_REALTIME_VSFR_COUNT];
+  CHECK(read_vsfr_batch(RC_REALTIME_VSFRS, RC_REALTIME_VSFR_COUNT, raw) == 2,
+        "ACC_Z unset should fail the batch");
+
+  emulator.set_vsfr(VSFR::ACC_Z, 1000u << 16);
+  int vsfr_req =
+      read_vsfr_batch_async(RC_REALTIME_VSFRS, RC_REALTIME_VSFR_COUNT);
+  int data_req = read_request_async(VS::DATA_BUF);
+  CHECK(read_vsfr_batch_wait(vsfr_req, RC_REALTIME_VSFR_COUNT, raw) == 0,
+        "batch");
+  rc_request_release(vsfr_req);
+  CHECK(read_request_wait(data_req) != nullptr, "pipelined DATA_BUF");
+  rc_request_release(data_req);
+
+  RCRealTimeValues values;
+  decode_realtime_vsfrs(raw, &values);
+  CHECK(values.count_rate_cps == 12 && values.dose_rate_uR_h == 15 &&
+            values.dose_uR == 99 && values.temperature_c == 23.5f,
+        "values");
+  CHECK(values.acc_x == -5 && values.acc_y == 7 && values.acc_z == 1000,
+        "accelerometer");
+
+  uint32_t ids[RC_VSFR_BATCH_MAX + 1] = {};
+  CHECK(read_vsfr_batch_async(ids, 0) < 0, "empty batch");
+  CHECK(read_vsfr_batch_async(ids, RC_VSFR_BATCH_MAX + 1) < 0,
+        "oversized batch");
+}
+
+static void test_faults() {
+  emulator.set_fault(RC_EMULATOR_FAULT_BAD_HEADER, 1);
+  CHECK(read_request(VS::DATA_BUF) == nullptr, "bad header accepted");
+  emulator.set_fault(RC_EMULATOR_FAULT_NONE, 0);
+  CHECK(read_request(VS::DATA_BUF) != nullptr, "no recovery after fault");
+
+  emulator.set_connected(false);
+  CHECK(!radiacode_ble_connected(), "connected");
+  CHECK(read_request_async(VS::DATA_BUF) < 0, "request while disconnected");
+  emulator.set_connected(true);
+
+  emulator.set_fault(RC_EMULATOR_FAULT_DROP, 1);
+  uint32_t start = millis();
+  CHECK(read_request(VS::DATA_BUF) == nullptr, "dropped response answered");
+  uint32_t waited = millis() - start;
+  CHECK(waited >= BLE_RESPONSE_TIMEOUT, "timed out after %u ms", waited);
+  emulator.set_fault(RC_EMULATOR_FAULT_NONE, 0);
+}
+
+// decodes every spectrum in a captured rc log and polls its events
+static void test_replay(const char* filename) {
+  std::ifstream f(filename);
+  CHECK(f.good(), "can't open %s", filename);
+  std::string line;
+  size_t lines = 0;
+  size_t events = 0;
+  size_t spectra = 0;
+  int spectrum[RC_SPECTRUM_CHANNELS];
+  while (std::getline(f, line)) {
+    lines++;
+    emulator.replay_line(line.c_str());
+    if (line.rfind("Spectrum:", 0) == 0) {
+      BytesBuffer* r = readSpectrumData();
+      float a0, a1, a2;
+      uint32_t ts;
+      CHECK(r != nullptr && decode_spectrum(r, spectrum, a0, a1, a2, ts) == 0,
+            "spectrum at line %zu", lines);
+      spectra++;
+    }
+    if (lines % 50 == 0) {
+      BytesBuffer* r = read_request(VS::DATA_BUF);
+      CHECK(r != nullptr, "DATA_BUF at line %zu", lines);
+      while (r != nullptr && r->size() >= 7) {
+        DataPoint d = consume_data_buf(r);
+        CHECK(d.index() < DP_RC_ERROR, "bad event at line %zu", lines);
+        events++;
+      }
+    }
+  }
+  printf("replay: %zu lines, %zu events, %zu spectra\n", lines, events,
+         spectra);
+}
+
+int main(int argc, char** argv) {
+  radiacode_ble_init();
+  rc_set_transport(&emulator);
+  CHECK(radiacode_ble_connected(), "emulator not connected");
+  CHECK(radiacode_ble_exchange() == 0, "exchange");
+
+  test_spectrum();
+  test_events();
+  test_vsfr_batch();
+  test_faults();
+  if (argc > 1) test_replay(argv[1]);
+
+  RCBleStats stats;
+  rc_ble_get_stats(&stats, false);
+  printf("%lu requests, %lu failed, %lu notifications\n",
+         (unsigned long)stats.requests, (unsigned long)stats.failures,
+         (unsigned long)stats.notifications);
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all passed\n");
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Pipelines RadiaCodeBLELib requests against RCEmulator answering from a
+// second thread, as notify does on target, with every 17th response
+// dropped, then releases requests while their responses are being claimed.
+// Build and run with make -C pnc-fsw/test
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "RCEmulator.h"
+#include "RadiacodeBLE.h"
+
+static int failures = 0;
+
+#define CHECK(cond, ...)                                     \
+  do {                                                       \
+    if (!(cond)) {                                           \
+      printf("FAIL %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+      printf(__VA_ARGS__);                                   \
+      printf("\n");                                          \
+      failures++;                                            \
+    }                                                        \
+  } while (0)
+
+static RCEmulator emulator;
+
+/**
+ * @brief Queues written chunks for the device thread to hand the emulator
+ *
+ */
+class ThreadedLink : public RCTransport {
+ public:
+  bool connected() override { return true; }
+  void write(const uint8_t* data, size_t len) override {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->chunks.emplace_back(data, data + len);
+  }
+
+  bool take(std::vector<uint8_t>& chunk) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->chunks.empty()) return false;
+    chunk = std::move(this->chunks.front());
+    this->chunks.pop_front();
+    return true;
+  }
+
+ private:
+  std::mutex mutex;
+  std::deque<std::vector<uint8_t>> chunks;
+};
+
+static ThreadedLink threaded_link;
+static std::atomic<bool> stop{false};
+
+static void device_thread() {
+  std::vector<uint8_t> chunk;
+  while (!stop) {
+    if (threaded_link.take(chunk)) {
+      emulator.write(chunk.data(), chunk.size());
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+int main() {
+  const int rounds = 300;
+  const int drop_every = 17;
+
+  radiacode_ble_init();
+  rc_set_transport(&threaded_link);
+  emulator.set_notify_size(7);
+  emulator.set_fault(RC_EMULATOR_FAULT_DROP, drop_every);
+  int truth[RC_SPECTRUM_CHANNELS];
+  for (int i = 0; i < RC_SPECTRUM_CHANNELS; i++) truth[i] = i % 50;
+  emulator.set_spectrum(truth, RC_SPECTRUM_CHANNELS, 1, 1, 2, 3);
+
+  std::thread device(device_thread);
+  int ok = 0;
+  int failed = 0;
+  for (int round = 0; round < rounds; round++) {
+    int requests[3] = {read_request_async(VS::DATA_BUF),
+                       read_request_async(VS::SPECTRUM),
+                       read_request_async(VS::DATA_BUF)};
+    for (int k = 0; k < 3; k++) {
+      CHECK(requests[k] >= 0, "round %d request %d not sent", round, k);
+      BytesBuffer* r = read_request_wait(requests[k]);
+      if (r == nullptr) {
+        failed++;
+      } else {
+        ok++;
+        if (k == 1) {
+          int got[RC_SPECTRUM_CHANNELS];
+          float a0, a1, a2;
+          uint32_t ts;
+          CHECK(decode_spectrum(r, got, a0, a1, a2, ts) == 0 &&
+                    memcmp(got, truth, sizeof(got)) == 0,
+                "round %d spectrum", round);
+        }
+      }
+      rc_request_release(requests[k]);
+    }
+  }
+  stop = true;
+  device.join();
+
+  RCBleStats stats;
+  rc_ble_get_stats(&stats, true);
+  // only dropped responses fail, each one fails a single request
+  CHECK(ok + failed == rounds * 3, "%d answered", ok + failed);
+  CHECK((uint32_t)failed == emulator.faults(), "%d failed, %u dropped",
+        failed, emulator.faults());
+  CHECK(stats.failures == (uint32_t)failed, "stats count %lu failures",
+        (unsigned long)stats.failures);
+  printf("threaded: %d ok, %d failed of %d requests\n", ok, failed,
+         rounds * 3);
+
+  // release right as the response arrives, racing notify's claim and hand
+  // over
+  emulator.set_fault(RC_EMULATOR_FAULT_NONE, 0);
+  stop = false;
+  device = std::thread(device_thread);
+  const int races = 2000;
+  for (int race = 0; race < races; race++) {
+    int handle = read_request_async(VS::DATA_BUF);
+    CHECK(handle >= 0, "race %d request not sent", race);
+    for (int spin = 0; spin < race % 200; spin++) {
+      std::this_thread::yield();
+    }
+    rc_request_release(handle);
+    // reuses the slot just released, so a hand over finishing after the
+    // release would complete it with the DATA_BUF response
+    int got[RC_SPECTRUM_CHANNELS];
+    float a0, a1, a2;
+    uint32_t ts;
+    BytesBuffer* r = read_request(VS::SPECTRUM);
+    CHECK(r != nullptr && decode_spectrum(r, got, a0, a1, a2, ts) == 0 &&
+              memcmp(got, truth, sizeof(got)) == 0,
+          "race %d spectrum after the release", race);
+  }
+  // every slot at once, each holding a buffer besides the one notify
+  // reassembles into, only fits if no release lost a buffer
+  int after = 0;
+  for (int round = 0; round < 20; round++) {
+    int held[RC_MAX_PENDING];
+    for (int k = 0; k < RC_MAX_PENDING; k++) {
+      held[k] = read_request_async(VS::DATA_BUF);
+    }
+    for (int k = 0; k < RC_MAX_PENDING; k++) {
+      if (read_request_wait(held[k]) != nullptr) after++;
+    }
+    for (int k = 0; k < RC_MAX_PENDING; k++) rc_request_release(held[k]);
+  }
+  stop = true;
+  device.join();
+  CHECK(after == 20 * RC_MAX_PENDING, "%d of %d answered after the races",
+        after, 20 * RC_MAX_PENDING);
+  printf("raced %d releases against claims\n", races);
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all passed\n");
+  return 0;
+}
@@ -0,0 +1,53 @@
+// Just enough of the Arduino core for RadiaCodeBLELib to build on a host,
+// defined in shim.cpp
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "pico/mutex.h"
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : str(s ? s : "") {}
+
+  const char* c_str() const { return str.c_str(); }
+  size_t length() const { return str.size(); }
+  String& operator+=(char c) {
+    str += c;
+    return *this;
+  }
+  bool operator==(const String& other) const { return str == other.str; }
+
+ private:
+  std::string str;
+};
+
+class HostSerial {
+ public:
+  size_t printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = vprintf(format, args);
+    va_end(args);
+    return n > 0 ? n : 0;
+  }
+};
+
+extern HostSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void tight_loop_contents() {}
+
+#endif
@@ -0,0 +1,60 @@
+// arduino-pico BLE client that never finds a device, tests swap in a
+// transport with rc_set_transport
+#ifndef BLE_SHIM_H
+#define BLE_SHIM_H
+
+#include <Arduino.h>
+
+class BLEUUID {
+ public:
+  BLEUUID(const char*) {}
+};
+
+class BLEAddress {
+ public:
+  String toString() { return String(); }
+};
+
+class BLERemoteCharacteristic {
+ public:
+  typedef void (*NotifyCallback)(BLERemoteCharacteristic*, const uint8_t*,
+                                 uint32_t);
+  bool setValue(const uint8_t*, size_t) { return false; }
+  void onNotify(NotifyCallback) {}
+  bool enableNotifications() { return false; }
+};
+
+class BLERemoteService {
+ public:
+  BLERemoteCharacteristic* characteristic(BLEUUID) { return nullptr; }
+};
+
+class BLEAdvertising {
+ public:
+  BLEAddress getAddress() { return BLEAddress(); }
+};
+
+class BLEScanReport {
+ public:
+  BLEAdvertising* begin() { return nullptr; }
+  BLEAdvertising* end() { return nullptr; }
+};
+
+class BLEClient {
+ public:
+  bool connect(BLEAdvertising&) { return false; }
+  BLERemoteService* service(BLEUUID) { return nullptr; }
+  bool connected() { return false; }
+  void disconnect() {}
+};
+
+class BLEClass {
+ public:
+  void begin() {}
+  BLEScanReport* scan() { return nullptr; }
+  BLEClient* client() { return nullptr; }
+};
+
+extern BLEClass BLE;
+
+#endif
@@ -0,0 +1,81 @@
+// The BTstack types and calls RadiaCodeBLELib uses, there is never a link on
+// the host
+#ifndef BTSTACK_SHIM_H
+#define BTSTACK_SHIM_H
+
+#include <stdint.h>
+
+typedef uint16_t hci_con_handle_t;
+typedef void (*btstack_packet_handler_t)(uint8_t packet_type,
+                                         uint16_t channel, uint8_t* packet,
+                                         uint16_t size);
+
+typedef struct {
+  void* next;
+  btstack_packet_handler_t callback;
+} btstack_packet_callback_registration_t;
+
+typedef struct {
+  uint16_t start_handle;
+  uint16_t value_handle;
+  uint16_t end_handle;
+  uint16_t properties;
+  uint16_t uuid16;
+  uint8_t uuid128[16];
+} gatt_client_characteristic_t;
+
+#define HCI_CON_HANDLE_INVALID 0xffff
+#define HCI_EVENT_PACKET 0x04
+#define HCI_EVENT_DISCONNECTION_COMPLETE 0x05
+#define HCI_EVENT_LE_META 0x3e
+#define HCI_SUBEVENT_LE_CONNECTION_COMPLETE 0x01
+#define GATT_EVENT_QUERY_COMPLETE 0xa0
+#define GATT_EVENT_CHARACTERISTIC_QUERY_RESULT 0xa2
+#define ERROR_CODE_SUCCESS 0x00
+#define ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER 0x02
+#define BTSTACK_ACL_BUFFERS_FULL 0x57
+#define GATT_CLIENT_BUSY 0x94
+#define ATT_PROPERTY_WRITE_WITHOUT_RESPONSE 0x04
+
+static inline uint8_t hci_event_packet_get_type(const uint8_t* packet) {
+  return packet[0];
+}
+static inline uint8_t hci_event_le_meta_get_subevent_code(
+    const uint8_t* packet) {
+  return packet[2];
+}
+static inline uint8_t hci_subevent_le_connection_complete_get_status(
+    const uint8_t* packet) {
+  return packet[3];
+}
+static inline hci_con_handle_t
+hci_subevent_le_connection_complete_get_connection_handle(
+    const uint8_t* packet) {
+  return packet[4] | (packet[5] << 8);
+}
+static inline hci_con_handle_t
+hci_event_disconnection_complete_get_connection_handle(
+    const uint8_t* packet) {
+  return packet[3] | (packet[4] << 8);
+}
+static inline void gatt_event_characteristic_query_result_get_characteristic(
+    const uint8_t*, gatt_client_characteristic_t*) {}
+
+static inline void hci_add_event_handler(
+    btstack_packet_callback_registration_t*) {}
+static inline uint8_t gatt_client_get_mtu(hci_con_handle_t, uint16_t*) {
+  return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+}
+static inline uint8_t
+gatt_client_discover_characteristics_for_handle_range_by_uuid128(
+    btstack_packet_handler_t, hci_con_handle_t, uint16_t, uint16_t,
+    const uint8_t*) {
+  return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+}
+static inline uint8_t
+gatt_client_write_value_of_characteristic_without_response(
+    hci_con_handle_t, uint16_t, uint16_t, uint8_t*) {
+  return ERROR_CODE_UNKNOWN_CONNECTION_IDENTIFIER;
+}
+
+#endif
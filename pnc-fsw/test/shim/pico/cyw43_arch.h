@@ -0,0 +1,11 @@
+// The BTstack lock is a no-op on the host, nothing runs in its context
+#ifndef PICO_CYW43_ARCH_SHIM_H
+#define PICO_CYW43_ARCH_SHIM_H
+
+typedef struct async_context async_context_t;
+
+static inline async_context_t* cyw43_arch_async_context() { return nullptr; }
+static inline void async_context_acquire_lock_blocking(async_context_t*) {}
+static inline void async_context_release_lock(async_context_t*) {}
+
+#endif
@@ -0,0 +1,13 @@
+// pico-sdk mutexes backed by std::mutex, defined in shim.cpp
+#ifndef PICO_MUTEX_SHIM_H
+#define PICO_MUTEX_SHIM_H
+
+typedef struct {
+  int id;
+} mutex_t;
+
+void mutex_init(mutex_t* mutex);
+void mutex_enter_blocking(mutex_t* mutex);
+void mutex_exit(mutex_t* mutex);
+
+#endif
@@ -0,0 +1,39 @@
+#include <Arduino.h>
+#include <BLE.h>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HostSerial Serial;
+BLEClass BLE;
+
+static const auto start = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+unsigned long micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void delay(unsigned long ms) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+  std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+// the library initialises a fixed handful of mutexes once
+static std::mutex mutexes[8];
+static int mutex_count = 0;
+
+void mutex_init(mutex_t* mutex) { mutex->id = mutex_count++ % 8; }
+void mutex_enter_blocking(mutex_t* mutex) { mutexes[mutex->id].lock(); }
+void mutex_exit(mutex_t* mutex) { mutexes[mutex->id].unlock(); }